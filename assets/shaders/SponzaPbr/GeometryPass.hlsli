@@ -0,0 +1,94 @@
+// G-buffer output shared by GeometryPass_PS.hlsl and GeometryPassBindless_PS.hlsl.
+// The including shader declares the material resources and defines the accessors:
+// MATERIAL_SAMPLE(name, tex_coord) samples the albedo, normal, gloss, roughness, metalness, ao or alpha texture,
+// MATERIAL_USE_NORMAL_MAPPING and MATERIAL_USE_GLOSS_INSTEAD_OF_ROUGHNESS select the material options.
+
+struct VS_OUTPUT
+{
+    float4 pos       : SV_POSITION;
+    float3 fragPos   : POSITION;
+    float3 normal    : NORMAL;
+    float3 tangent   : TANGENT;
+    float2 texCoord  : TEXCOORD;
+};
+
+static const bool is_packed_normal = false;
+static const bool is_sun_temple = false;
+static const bool use_standard_channel_binding = true;
+
+float4 applyGamma(float4 _color)
+{
+    return float4(pow(abs(_color.rgb), 2.2), _color.a);
+}
+
+struct PS_OUT
+{
+    float4 gPosition : SV_Target0;
+    float4 gNormal   : SV_Target1;
+    float4 gAlbedo   : SV_Target2;
+    float4 gMaterial : SV_Target3;
+};
+
+float3 CalcBumpedNormal(VS_OUTPUT input)
+{
+    float3 N = normalize(input.normal);
+    float3 T = normalize(input.tangent);
+    T = normalize(T - dot(T, N) * N);
+    float3 B = normalize(cross(T, N));
+    float3x3 tbn = float3x3(T, B, N);
+    float3 normal = MATERIAL_SAMPLE(normal, input.texCoord).rgb;
+    if (use_flip_normal_y)
+        normal.y = 1 - normal.y;
+    normal = normalize(2.0 * normal - 1.0);
+    if (is_packed_normal)
+    {
+        normal.z = sqrt(1 - saturate(dot(normal.xy, normal.xy)));
+        normal = normalize(normal);
+    }
+    normal = normalize(mul(normal, tbn));
+    return normal;
+}
+
+PS_OUT main(VS_OUTPUT input)
+{
+    if (use_standard_channel_binding)
+    {
+        if (MATERIAL_SAMPLE(alpha, input.texCoord).r < 0.5)
+            discard;
+    }
+    else
+    {
+        if (MATERIAL_SAMPLE(albedo, input.texCoord).a < 0.5)
+            discard;
+    }
+
+    PS_OUT output;
+    output.gPosition = float4(input.fragPos.xyz, 1);
+
+    if (MATERIAL_USE_NORMAL_MAPPING)
+        output.gNormal.rgb = CalcBumpedNormal(input);
+    else
+        output.gNormal.rgb = normalize(input.normal);
+    output.gNormal.a = 1.0;
+
+    output.gAlbedo = float4(applyGamma(MATERIAL_SAMPLE(albedo, input.texCoord)).rgb, 1.0);
+
+    if (use_standard_channel_binding)
+    {
+        if (MATERIAL_USE_GLOSS_INSTEAD_OF_ROUGHNESS)
+            output.gMaterial.r = 1.0 - MATERIAL_SAMPLE(gloss, input.texCoord).r;
+        else
+            output.gMaterial.r = MATERIAL_SAMPLE(roughness, input.texCoord).r;
+        output.gMaterial.g = MATERIAL_SAMPLE(metalness, input.texCoord).r;
+    }
+    else
+    {
+        output.gMaterial.r = MATERIAL_SAMPLE(roughness, input.texCoord).g;
+        output.gMaterial.g = MATERIAL_SAMPLE(roughness, input.texCoord).b;
+    }
+
+    output.gMaterial.b = MATERIAL_SAMPLE(ao, input.texCoord).r;
+    output.gMaterial.a = ibl_source;
+
+    return output;
+}
@@ -0,0 +1,35 @@
+struct Material
+{
+    uint albedo;
+    uint normal;
+    uint gloss;
+    uint roughness;
+    uint metalness;
+    uint ao;
+    uint alpha;
+    uint flags;
+};
+
+static const uint kMaterialUseNormalMap = 1;
+static const uint kMaterialUseGlossInsteadOfRoughness = 2;
+
+StructuredBuffer<Material> g_materials;
+
+// Elements take the slots after the array start, so it stays clear of the automatically assigned registers
+Texture2D g_textures[256] : register(t16);
+
+SamplerState g_sampler;
+
+cbuffer Settings
+{
+    uint material_id;
+    bool use_normal_mapping;
+    bool use_flip_normal_y;
+    int ibl_source;
+};
+
+#define MATERIAL_SAMPLE(name, tex_coord) g_textures[g_materials[material_id].name].Sample(g_sampler, tex_coord)
+#define MATERIAL_USE_NORMAL_MAPPING (use_normal_mapping && (g_materials[material_id].flags & kMaterialUseNormalMap))
+#define MATERIAL_USE_GLOSS_INSTEAD_OF_ROUGHNESS (g_materials[material_id].flags & kMaterialUseGlossInsteadOfRoughness)
+
+#include "GeometryPass.hlsli"
@@ -6,6 +6,7 @@ struct VS_INPUT
     float3 tangent    : TANGENT;
     uint bones_offset : BONES_OFFSET;
     uint bones_count  : BONES_COUNT;
+    float4 instance   : INSTANCE_OFFSET;
 };
 
 cbuffer ConstantBuf
@@ -28,7 +29,7 @@ struct VS_OUTPUT
 VS_OUTPUT main(VS_INPUT vs_in)
 {
     VS_OUTPUT vs_out;
-    float4 pos = float4(vs_in.pos, 1.0);
+    float4 pos = float4(vs_in.pos * vs_in.instance.w + vs_in.instance.xyz, 1.0);
     float4 worldPos = mul(pos, model);
     vs_out.fragPos = worldPos.xyz;
     vs_out.pos = mul(worldPos, mul(view, projection));
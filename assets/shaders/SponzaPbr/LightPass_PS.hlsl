@@ -4,11 +4,18 @@ struct VS_OUTPUT
     float2 texcoord : TEXCOORD;
 };
 
-#ifndef SAMPLE_COUNT
+// The sample count is a specialization constant, only the texture type needs a separate compilation
+#ifdef SPIRV
+[[vk::constant_id(0)]] const uint SAMPLE_COUNT = 1;
+#elif !defined(SAMPLE_COUNT)
 #define SAMPLE_COUNT 1
 #endif
 
-#if SAMPLE_COUNT > 1
+#ifndef MULTISAMPLED
+#define MULTISAMPLED 0
+#endif
+
+#if MULTISAMPLED
 #define TEXTURE_TYPE Texture2DMS<float4>
 #else
 #define TEXTURE_TYPE Texture2D
@@ -68,7 +75,7 @@ cbuffer Settings
 
 float4 getTexture(TEXTURE_TYPE _texture, float2 _tex_coord, int ss_index, bool _need_gamma = false)
 {
-#if SAMPLE_COUNT > 1
+#if MULTISAMPLED
     float3 gbufferDim;
     _texture.GetDimensions(gbufferDim.x, gbufferDim.y, gbufferDim.z);
     float2 texcoord = _tex_coord * float2(gbufferDim.xy);
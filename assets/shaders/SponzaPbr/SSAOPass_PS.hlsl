@@ -4,11 +4,17 @@ struct VS_OUTPUT
     float2 texCoord : TEXCOORD;
 };
 
-#ifndef SAMPLE_COUNT
+#ifdef SPIRV
+[[vk::constant_id(0)]] const uint SAMPLE_COUNT = 1;
+#elif !defined(SAMPLE_COUNT)
 #define SAMPLE_COUNT 1
 #endif
 
-#if SAMPLE_COUNT > 1
+#ifndef MULTISAMPLED
+#define MULTISAMPLED 0
+#endif
+
+#if MULTISAMPLED
 #define TEXTURE_TYPE Texture2DMS<float4>
 #else
 #define TEXTURE_TYPE Texture2D
@@ -9,6 +9,7 @@ struct VertexInput
     float2 texCoord   : TEXCOORD;
     uint bones_offset : BONES_OFFSET;
     uint bones_count  : BONES_COUNT;
+    float4 instance   : INSTANCE_OFFSET;
 };
 
 struct VertexOutput
@@ -20,7 +21,7 @@ struct VertexOutput
 VertexOutput main(VertexInput input)
 {
     VertexOutput output;
-    float4 worldPosition = mul(float4(input.Position, 1.0), World);
+    float4 worldPosition = mul(float4(input.Position * input.instance.w + input.instance.xyz, 1.0), World);
     output.pos = worldPosition;
     output.texCoord = input.texCoord;
     return output;
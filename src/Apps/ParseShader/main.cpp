@@ -2,6 +2,8 @@
 #include <Utilities/DXUtility.h>
 #include <Shader/DXCompiler.h>
 #include <Shader/DXReflector.h>
+#include <Shader/SpirvCompiler.h>
+#include <spirv_cross.hpp>
 #include <mustache.hpp>
 #include <d3dcompiler.h>
 #include <wrl.h>
@@ -34,6 +36,44 @@ inline void ThrowIfFailed(bool res, const std::string& msg)
         throw std::runtime_error(msg);
 }
 
+// Vertex inputs with an INSTANCE_ semantic are fetched per instance, e.g. float4x4 world : INSTANCE_WORLD
+static bool IsInstanceSemantic(std::string semantic)
+{
+    for (auto& c : semantic)
+        c = std::toupper(c);
+    return semantic.find("INSTANCE_") == 0;
+}
+
+// Specialization constants only exist in SPIR-V, e.g. [[vk::constant_id(0)]] const uint SAMPLE_COUNT = 1
+static mustache::data ParseSpecializationConstants(const spirv_cross::Compiler& compiler)
+{
+    mustache::data tconstants{ mustache::data::type::list };
+    for (const auto& constant : compiler.get_specialization_constants())
+    {
+        const spirv_cross::SPIRConstant& value = compiler.get_constant(constant.id);
+        mustache::data tconstant;
+        tconstant.set("Name", compiler.get_name(constant.id));
+        tconstant.set("ConstantId", std::to_string(constant.constant_id));
+        switch (compiler.get_type(value.constant_type).basetype)
+        {
+        case spirv_cross::SPIRType::BaseType::Float:
+            tconstant.set("Type", "float");
+            tconstant.set("Default", std::to_string(value.scalar_f32()) + "f");
+            break;
+        case spirv_cross::SPIRType::BaseType::Int:
+            tconstant.set("Type", "int32_t");
+            tconstant.set("Default", std::to_string(value.scalar_i32()));
+            break;
+        default:
+            tconstant.set("Type", "uint32_t");
+            tconstant.set("Default", std::to_string(value.scalar()));
+            break;
+        }
+        tconstants.push_back(tconstant);
+    }
+    return tconstants;
+}
+
 class ShaderReflection
 {
 public:
@@ -175,6 +215,12 @@ private:
         m_tcontext["Entrypoint"] = m_entrypoint;
         m_tcontext["Target"] = m_target;
 
+        SpirvOption option = {};
+        option.auto_map_bindings = true;
+        option.hlsl_iomap = true;
+        spirv_cross::Compiler compiler(SpirvCompile({ m_option.shader_path, m_entrypoint, m_target }, option));
+        m_tcontext["SpecConstants"] = ParseSpecializationConstants(compiler);
+
         mustache::data tcbuffers{ mustache::data::type::list };
 
         D3D12_SHADER_DESC desc = {};
@@ -252,6 +298,16 @@ private:
                 ttexture.set("Name", res_desc.Name);
                 ttexture.set("Slot", std::to_string(res_desc.BindPoint));
                 ttexture.set("Separator", ttextures.is_empty_list() ? ":" : ",");
+                if (res_desc.BindCount > 1)
+                {
+                    ttexture.set("BindingType", "SRVArrayBinding");
+                    ttexture.set("ArraySuffix", ", " + std::to_string(res_desc.BindCount));
+                }
+                else
+                {
+                    ttexture.set("BindingType", "SRVBinding");
+                    ttexture.set("ArraySuffix", "");
+                }
                 ttextures.push_back(ttexture);
                 break;  
             }
@@ -278,6 +334,7 @@ private:
         if (m_target.find("vs") != -1)
         {
             mustache::data tinputs{ mustache::data::type::list };
+            mustache::data tinstance_inputs{ mustache::data::type::list };
             std::map<std::string, size_t> use_name;
             for (UINT i = 0; i < desc.InputParameters; ++i)
             {
@@ -297,8 +354,11 @@ private:
                 tinput.set("Name", input_name);
                 tinput.set("Slot", std::to_string(i));
                 tinputs.push_back(tinput);
+                if (IsInstanceSemantic(param_desc.SemanticName))
+                    tinstance_inputs.push_back(tinput);
             }
             m_tcontext["Inputs"] = mustache::data{ tinputs };
+            m_tcontext["InstanceInputs"] = mustache::data{ tinstance_inputs };
         }
 
         if (m_target.find("ps") != -1)
@@ -14,6 +14,44 @@
 #include <map>
 #include <set>
 
+// Vertex inputs with an INSTANCE_ semantic are fetched per instance, e.g. float4x4 world : INSTANCE_WORLD
+static bool IsInstanceSemantic(std::string semantic)
+{
+    for (auto& c : semantic)
+        c = std::toupper(c);
+    return semantic.find("INSTANCE_") == 0;
+}
+
+// Specialization constants only exist in SPIR-V, e.g. [[vk::constant_id(0)]] const uint SAMPLE_COUNT = 1
+static kainjow::mustache::data ParseSpecializationConstants(const spirv_cross::Compiler& compiler)
+{
+    kainjow::mustache::data tconstants{ kainjow::mustache::data::type::list };
+    for (const auto& constant : compiler.get_specialization_constants())
+    {
+        const spirv_cross::SPIRConstant& value = compiler.get_constant(constant.id);
+        kainjow::mustache::data tconstant;
+        tconstant.set("Name", compiler.get_name(constant.id));
+        tconstant.set("ConstantId", std::to_string(constant.constant_id));
+        switch (compiler.get_type(value.constant_type).basetype)
+        {
+        case spirv_cross::SPIRType::BaseType::Float:
+            tconstant.set("Type", "float");
+            tconstant.set("Default", std::to_string(value.scalar_f32()) + "f");
+            break;
+        case spirv_cross::SPIRType::BaseType::Int:
+            tconstant.set("Type", "int32_t");
+            tconstant.set("Default", std::to_string(value.scalar_i32()));
+            break;
+        default:
+            tconstant.set("Type", "uint32_t");
+            tconstant.set("Default", std::to_string(value.scalar()));
+            break;
+        }
+        tconstants.push_back(tconstant);
+    }
+    return tconstants;
+}
+
 class ShaderReflection
 {
 public:
@@ -153,6 +191,7 @@ private:
         m_tcontext["ShaderPath"] = m_shader_desc.shader_path;
         m_tcontext["Entrypoint"] = m_shader_desc.entrypoint;
         m_tcontext["Target"] = m_shader_desc.target;
+        m_tcontext["SpecConstants"] = ParseSpecializationConstants(compiler);
 
         kainjow::mustache::data tcbuffers{ kainjow::mustache::data::type::list };
 
@@ -222,6 +261,17 @@ private:
                 tresource.set("Name", name);
                 tresource.set("Slot", std::to_string(compiler.get_decoration(resource.id, spv::DecorationBinding)));
                 tresource.set("Separator", tdata->is_empty_list() ? ":" : ",");
+                auto& type = compiler.get_type(resource.type_id);
+                if (res_type == ResourceType::kSrv && !type.array.empty())
+                {
+                    tresource.set("BindingType", "SRVArrayBinding");
+                    tresource.set("ArraySuffix", ", " + std::to_string(type.array.front()));
+                }
+                else
+                {
+                    tresource.set("BindingType", "SRVBinding");
+                    tresource.set("ArraySuffix", "");
+                }
                 tdata->push_back(tresource);
             }
         };
@@ -238,6 +288,7 @@ private:
         if (m_shader_desc.type == ShaderType::kVertex)
         {
             kainjow::mustache::data tinputs{ kainjow::mustache::data::type::list };
+            kainjow::mustache::data tinstance_inputs{ kainjow::mustache::data::type::list };
             for (const auto& resource : resources.stage_inputs)
             {
                 kainjow::mustache::data tinput;
@@ -253,8 +304,11 @@ private:
                 tinput.set("Name", semantic);
                 tinput.set("Slot", std::to_string(compiler.get_decoration(resource.id, spv::DecorationLocation)));
                 tinputs.push_back(tinput);
+                if (IsInstanceSemantic(semantic))
+                    tinstance_inputs.push_back(tinput);
             }
             m_tcontext["Inputs"] = kainjow::mustache::data{ tinputs };
+            m_tcontext["InstanceInputs"] = kainjow::mustache::data{ tinstance_inputs };
         }
 
         if (m_shader_desc.type == ShaderType::kPixel)
@@ -56,3 +56,8 @@ void BRDFGen::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void BRDFGen::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.Write(output.brdf);
+}
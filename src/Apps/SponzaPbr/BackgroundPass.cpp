@@ -58,3 +58,10 @@ void BackgroundPass::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void BackgroundPass::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.Read(m_input.environment);
+    builder.Write(m_input.rtv);
+    builder.Write(m_input.dsv);
+}
@@ -31,6 +31,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     Settings m_settings;
@@ -77,6 +77,7 @@ void ComputeLuminance::OnRender()
     size_t buf_id = 0;
     if (m_settings.use_tone_mapping)
     {
+        m_context.BeginAsyncCompute();
         GetLum2DPassCS(buf_id, m_thread_group_x, m_thread_group_y);
         for (int block_size = m_thread_group_x * m_thread_group_y; block_size > 1;)
         {
@@ -84,6 +85,8 @@ void ComputeLuminance::OnRender()
             GetLum1DPassCS(++buf_id, block_size, next_block_size);
             block_size = next_block_size;
         }
+        m_context.EndAsyncCompute();
+        m_context.WaitAsyncCompute();
         Draw(buf_id);
     }
     else
@@ -121,3 +124,12 @@ void ComputeLuminance::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void ComputeLuminance::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    // Writes the back buffer
+    builder.SetSideEffect();
+    builder.Read(m_input.hdr_res);
+    builder.Write(m_input.rtv);
+    builder.Write(m_input.dsv);
+}
@@ -4,6 +4,7 @@
 #include <Scene/SceneBase.h>
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
+#include <RenderGraph/RenderGraph.h>
 #include <ProgramRef/HDRLum1DPassCS.h>
 #include <ProgramRef/HDRLum2DPassCS.h>
 #include <ProgramRef/HDRApplyPS.h>
@@ -30,6 +31,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     void GetLum2DPassCS(size_t buf_id, uint32_t thread_group_x, uint32_t thread_group_y);
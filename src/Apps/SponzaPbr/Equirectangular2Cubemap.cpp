@@ -117,3 +117,9 @@ void Equirectangular2Cubemap::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void Equirectangular2Cubemap::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.Read(m_input.hdr);
+    builder.Write(output.environment);
+}
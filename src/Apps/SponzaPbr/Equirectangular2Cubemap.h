@@ -30,6 +30,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     void DrawEquirectangular2Cubemap();
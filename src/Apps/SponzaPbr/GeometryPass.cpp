@@ -9,8 +9,9 @@ GeometryPass::GeometryPass(Context& context, const Input& input, int width, int
     , m_width(width)
     , m_height(height)
     , m_program(context)
+    , m_task_programs(context, &m_program)
+    , m_bindless_programs(context)
 {
-    CreateSizeDependentResources();
     m_sampler = m_context.CreateSampler({
         SamplerFilter::kAnisotropic,
         SamplerTextureAddressMode::kWrap,
@@ -41,6 +42,7 @@ void GeometryPass::OnRender()
     m_program.ps.om.rtv3.Attach(output.material).Clear(color);
     m_program.ps.om.dsv.Attach(output.dsv).Clear(ClearFlag::kDepth | ClearFlag::kStencil, 1.0f, 0);
 
+    Draws draws;
     bool skiped = false;
     for (auto& model : m_input.scene_list)
     {
@@ -49,59 +51,206 @@ void GeometryPass::OnRender()
             skiped = true;
             continue;
         }
-        m_program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
-        m_program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
-        m_program.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+        for (auto& range : model.ia.ranges)
+            draws.emplace_back(&model, &range);
+    }
 
-        model.ia.indices.Bind();
-        model.ia.positions.BindToSlot(m_program.vs.ia.POSITION);
-        model.ia.normals.BindToSlot(m_program.vs.ia.NORMAL);
-        model.ia.texcoords.BindToSlot(m_program.vs.ia.TEXCOORD);
-        model.ia.tangents.BindToSlot(m_program.vs.ia.TANGENT);
+    if (m_settings.use_bindless_materials && UpdateBindlessMaterials(draws))
+    {
+        RenderBindless(draws);
+        return;
+    }
 
-        for (auto& range : model.ia.ranges)
+    size_t task_count = m_task_programs.Prepare(draws.size());
+    m_context.ExecuteInParallel(task_count, [&](size_t task)
+    {
+        auto& program = m_task_programs.Get(task);
+        m_context.UseProgram(program);
+
+        program.vs.cbuffer.ConstantBuf.view = m_program.vs.cbuffer.ConstantBuf.view;
+        program.vs.cbuffer.ConstantBuf.projection = m_program.vs.cbuffer.ConstantBuf.projection;
+        program.ps.sampler.g_sampler.Attach(m_sampler);
+        program.ps.om.rtv0.Attach(output.position);
+        program.ps.om.rtv1.Attach(output.normal);
+        program.ps.om.rtv2.Attach(output.albedo);
+        program.ps.om.rtv3.Attach(output.material);
+        program.ps.om.dsv.Attach(output.dsv);
+
+        Model* bound_model = nullptr;
+        size_t end = m_task_programs.GetEndDraw(task, draws.size());
+        for (size_t i = m_task_programs.GetFirstDraw(task); i < end; ++i)
         {
+            Model& model = *draws[i].first;
+            const MeshRange& range = *draws[i].second;
+            if (bound_model != &model)
+            {
+                bound_model = &model;
+                program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+                program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+                program.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+
+                model.ia.indices.Bind();
+                model.ia.positions.BindToSlot(program.vs.ia.POSITION);
+                model.ia.normals.BindToSlot(program.vs.ia.NORMAL);
+                model.ia.texcoords.BindToSlot(program.vs.ia.TEXCOORD);
+                model.ia.tangents.BindToSlot(program.vs.ia.TANGENT);
+                model.instances.BindToSlot(program.vs.ia.INSTANCE_OFFSET);
+            }
+
             auto& material = model.GetMaterial(range.id);
 
-            m_program.ps.cbuffer.Settings.use_normal_mapping = material.texture.normal && m_settings.normal_mapping;
-            m_program.ps.cbuffer.Settings.use_gloss_instead_of_roughness = material.texture.glossiness && !material.texture.roughness;
-            m_program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
+            program.ps.cbuffer.Settings.use_normal_mapping = material.texture.normal && m_settings.normal_mapping;
+            program.ps.cbuffer.Settings.use_gloss_instead_of_roughness = material.texture.glossiness && !material.texture.roughness;
+            program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
 
-            m_program.ps.srv.normalMap.Attach(material.texture.normal);
-            m_program.ps.srv.albedoMap.Attach(material.texture.albedo);
-            m_program.ps.srv.glossMap.Attach(material.texture.glossiness);
-            m_program.ps.srv.roughnessMap.Attach(material.texture.roughness);
-            m_program.ps.srv.metalnessMap.Attach(material.texture.metalness);
-            m_program.ps.srv.aoMap.Attach(material.texture.occlusion);
-            m_program.ps.srv.alphaMap.Attach(material.texture.opacity);
+            program.ps.srv.normalMap.Attach(material.texture.normal);
+            program.ps.srv.albedoMap.Attach(material.texture.albedo);
+            program.ps.srv.glossMap.Attach(material.texture.glossiness);
+            program.ps.srv.roughnessMap.Attach(material.texture.roughness);
+            program.ps.srv.metalnessMap.Attach(material.texture.metalness);
+            program.ps.srv.aoMap.Attach(material.texture.occlusion);
+            program.ps.srv.alphaMap.Attach(material.texture.opacity);
 
-            m_context.DrawIndexed(range.index_count, range.start_index_location, range.base_vertex_location);
+            m_context.DrawIndexedInstanced(range.index_count, model.instances.Count(), range.start_index_location, range.base_vertex_location, 0);
         }
+    });
+}
+
+bool GeometryPass::UpdateBindlessMaterials(const Draws& draws)
+{
+    if (!m_context.GetMaxBindlessTextures())
+        return false;
+    m_bindless_programs.Prepare(1);
+    uint32_t max_textures = std::min(m_context.GetMaxBindlessTextures(), m_bindless_programs.Get(0).ps.srv.g_textures.GetCount());
+
+    auto get_texture_id = [&](const Resource::Ptr& res) -> uint32_t
+    {
+        if (!res)
+            return 0;
+        auto it = m_bindless_texture_ids.find(res);
+        if (it != m_bindless_texture_ids.end())
+            return it->second;
+        uint32_t id = static_cast<uint32_t>(m_bindless_textures.size());
+        m_bindless_textures.emplace_back(res);
+        m_bindless_texture_ids.emplace(res, id);
+        return id;
+    };
+
+    // The table only grows, so a steady scene uploads it once
+    bool changed = false;
+    m_draw_material_ids.resize(draws.size());
+    for (size_t i = 0; i < draws.size(); ++i)
+    {
+        const Material& material = draws[i].first->GetMaterial(draws[i].second->id);
+        auto it = m_bindless_material_ids.find(&material);
+        if (it == m_bindless_material_ids.end())
+        {
+            BindlessMaterial desc = {};
+            desc.albedo = get_texture_id(material.texture.albedo);
+            desc.normal = get_texture_id(material.texture.normal);
+            desc.gloss = get_texture_id(material.texture.glossiness);
+            desc.roughness = get_texture_id(material.texture.roughness);
+            desc.metalness = get_texture_id(material.texture.metalness);
+            desc.ao = get_texture_id(material.texture.occlusion);
+            desc.alpha = get_texture_id(material.texture.opacity);
+            if (material.texture.normal)
+                desc.flags |= kMaterialUseNormalMap;
+            if (material.texture.glossiness && !material.texture.roughness)
+                desc.flags |= kMaterialUseGlossInsteadOfRoughness;
+            it = m_bindless_material_ids.emplace(&material, static_cast<uint32_t>(m_bindless_materials.size())).first;
+            m_bindless_materials.emplace_back(desc);
+            changed = true;
+        }
+        m_draw_material_ids[i] = it->second;
     }
+
+    if (m_bindless_textures.size() > max_textures || m_bindless_materials.empty())
+        return false;
+
+    if (changed)
+    {
+        uint32_t buffer_size = static_cast<uint32_t>(m_bindless_materials.size() * sizeof(BindlessMaterial));
+        m_bindless_material_buffer = m_context.CreateBuffer(BindFlag::kSrv | BindFlag::kCpuWrite, buffer_size, sizeof(BindlessMaterial));
+        m_context.UpdateBuffer(m_bindless_material_buffer, 0, m_bindless_materials.data(), buffer_size);
+        ++m_bindless_version;
+    }
+    return true;
+}
+
+void GeometryPass::RenderBindless(const Draws& draws)
+{
+    size_t task_count = m_bindless_programs.Prepare(draws.size());
+    m_bindless_program_versions.resize(m_bindless_programs.GetCreatedCount(), ~0);
+
+    m_context.ExecuteInParallel(task_count, [&](size_t task)
+    {
+        auto& program = m_bindless_programs.Get(task);
+        m_context.UseProgram(program);
+
+        program.vs.cbuffer.ConstantBuf.view = m_program.vs.cbuffer.ConstantBuf.view;
+        program.vs.cbuffer.ConstantBuf.projection = m_program.vs.cbuffer.ConstantBuf.projection;
+        program.ps.cbuffer.Settings.use_normal_mapping = m_settings.normal_mapping;
+        program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
+        program.ps.sampler.g_sampler.Attach(m_sampler);
+        program.ps.om.rtv0.Attach(output.position);
+        program.ps.om.rtv1.Attach(output.normal);
+        program.ps.om.rtv2.Attach(output.albedo);
+        program.ps.om.rtv3.Attach(output.material);
+        program.ps.om.dsv.Attach(output.dsv);
+
+        // Textures are attached when the table changes, draws keep the same descriptor set afterwards
+        if (m_bindless_program_versions[m_bindless_programs.GetIndex(task)] != m_bindless_version)
+        {
+            program.ps.srv.g_materials.Attach(m_bindless_material_buffer);
+            for (uint32_t i = 0; i < m_bindless_textures.size(); ++i)
+                program.ps.srv.g_textures.Attach(i, m_bindless_textures[i]);
+            m_bindless_program_versions[m_bindless_programs.GetIndex(task)] = m_bindless_version;
+        }
+
+        Model* bound_model = nullptr;
+        size_t end = m_bindless_programs.GetEndDraw(task, draws.size());
+        for (size_t i = m_bindless_programs.GetFirstDraw(task); i < end; ++i)
+        {
+            Model& model = *draws[i].first;
+            const MeshRange& range = *draws[i].second;
+            if (bound_model != &model)
+            {
+                bound_model = &model;
+                program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+                program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+                program.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+
+                model.ia.indices.Bind();
+                model.ia.positions.BindToSlot(program.vs.ia.POSITION);
+                model.ia.normals.BindToSlot(program.vs.ia.NORMAL);
+                model.ia.texcoords.BindToSlot(program.vs.ia.TEXCOORD);
+                model.ia.tangents.BindToSlot(program.vs.ia.TANGENT);
+                model.instances.BindToSlot(program.vs.ia.INSTANCE_OFFSET);
+            }
+
+            program.ps.cbuffer.Settings.material_id = m_draw_material_ids[i];
+            m_context.DrawIndexedInstanced(range.index_count, model.instances.Count(), range.start_index_location, range.base_vertex_location, 0);
+        }
+    });
 }
 
 void GeometryPass::OnResize(int width, int height)
 {
     m_width = width;
     m_height = height;
-    CreateSizeDependentResources();
 }
 
 void GeometryPass::OnModifySettings(const Settings& settings)
 {
-    Settings prev = m_settings;
     m_settings = settings;
-    if (prev.msaa_count != settings.msaa_count)
-    {
-        CreateSizeDependentResources();
-    }
 }
 
-void GeometryPass::CreateSizeDependentResources()
+void GeometryPass::OnSetup(RenderGraph::PassBuilder& builder)
 {
-    output.position = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_settings.msaa_count, m_width, m_height, 1);
-    output.normal = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_settings.msaa_count, m_width, m_height, 1);
-    output.albedo = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_settings.msaa_count, m_width, m_height, 1);
-    output.material = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_settings.msaa_count, m_width, m_height, 1);
-    output.dsv = m_context.CreateTexture((BindFlag)(BindFlag::kDsv), gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, m_settings.msaa_count, m_width, m_height, 1);
+    RenderGraph::TextureDesc desc = { BindFlag::kRtv | BindFlag::kSrv, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_settings.msaa_count, m_width, m_height };
+    builder.Create(output.position, desc);
+    builder.Create(output.normal, desc);
+    builder.Create(output.albedo, desc);
+    builder.Create(output.material, desc);
+    builder.Create(output.dsv, { BindFlag::kDsv, gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, m_settings.msaa_count, m_width, m_height });
 }
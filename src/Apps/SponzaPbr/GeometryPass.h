@@ -1,11 +1,15 @@
 #pragma once
 
 #include "Settings.h"
+#include "TaskPrograms.h"
 #include <Scene/SceneBase.h>
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
+#include <RenderGraph/RenderGraph.h>
+#include <ProgramRef/GeometryPassBindlessPS.h>
 #include <ProgramRef/GeometryPassPS.h>
 #include <ProgramRef/GeometryPassVS.h>
+#include <map>
 
 class GeometryPass : public IPass, public IModifySettings
 {
@@ -31,6 +35,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings& settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     Context& m_context;
@@ -38,8 +43,37 @@ private:
     int m_width;
     int m_height;
     Program<GeometryPassPS, GeometryPassVS> m_program;
+    TaskPrograms<Program<GeometryPassPS, GeometryPassVS>> m_task_programs;
 
-    void CreateSizeDependentResources();
+    using Draws = std::vector<std::pair<Model*, const MeshRange*>>;
+    bool UpdateBindlessMaterials(const Draws& draws);
+    void RenderBindless(const Draws& draws);
+
+    // Bindless mode: every texture of the scene sits in one array, a draw only selects its entry of the material table
+    using BindlessProgram = Program<GeometryPassBindlessPS, GeometryPassVS>;
+    // Flags of BindlessMaterial, same values as in GeometryPassBindless_PS.hlsl
+    static constexpr uint32_t kMaterialUseNormalMap = 1;
+    static constexpr uint32_t kMaterialUseGlossInsteadOfRoughness = 2;
+    struct BindlessMaterial
+    {
+        uint32_t albedo;
+        uint32_t normal;
+        uint32_t gloss;
+        uint32_t roughness;
+        uint32_t metalness;
+        uint32_t ao;
+        uint32_t alpha;
+        uint32_t flags;
+    };
+    TaskPrograms<BindlessProgram> m_bindless_programs;
+    std::vector<size_t> m_bindless_program_versions;
+    std::map<const Material*, uint32_t> m_bindless_material_ids;
+    std::map<Resource::Ptr, uint32_t> m_bindless_texture_ids;
+    std::vector<Resource::Ptr> m_bindless_textures;
+    std::vector<BindlessMaterial> m_bindless_materials;
+    std::vector<uint32_t> m_draw_material_ids;
+    Resource::Ptr m_bindless_material_buffer;
+    size_t m_bindless_version = 0;
 
     Resource::Ptr m_sampler;
     Settings m_settings;
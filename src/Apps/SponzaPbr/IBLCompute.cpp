@@ -311,6 +311,8 @@ void IBLCompute::DrawBackgroud(Model& ibl_model)
 
 void IBLCompute::DrawDownSample(Model & ibl_model, size_t texture_mips)
 {
+    // Runs while the faces of the next requested model are drawn
+    m_context.BeginAsyncCompute();
     m_context.UseProgram(m_program_downsample);
     for (size_t i = 1; i < texture_mips; ++i)
     {
@@ -318,6 +320,7 @@ void IBLCompute::DrawDownSample(Model & ibl_model, size_t texture_mips)
         m_program_downsample.cs.uav.outputTexture.Attach(ibl_model.ibl_rtv, {i, 1});
         m_context.Dispatch((m_size >> i) / 8, (m_size >> i) / 8, 6);
     }
+    m_context.EndAsyncCompute();
 }
 
 void IBLCompute::OnResize(int width, int height)
@@ -328,3 +331,11 @@ void IBLCompute::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void IBLCompute::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    // Renders into the ibl_rtv of the scene models
+    builder.SetSideEffect();
+    builder.Read(m_input.shadow_pass.srv);
+    builder.Read(m_input.environment);
+}
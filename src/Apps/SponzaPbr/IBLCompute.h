@@ -5,6 +5,7 @@
 #include <Scene/SceneBase.h>
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
+#include <RenderGraph/RenderGraph.h>
 #include <ProgramRef/IBLComputeVS.h>
 #include <ProgramRef/IBLComputeGS.h>
 #include <ProgramRef/IBLComputePS.h>
@@ -38,6 +39,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     void DrawPrePass(Model& ibl_model);
@@ -3,8 +3,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <Geometry/IABuffer.h>
 #include <Texture/FormatHelper.h>
+#include <algorithm>
 
 ImGuiPass::ImGuiPass(Context& context, const Input& input, int width, int height)
     : m_context(context)
@@ -34,12 +34,28 @@ ImGuiPass::~ImGuiPass()
     ImGui::Shutdown();
 }
 
+template<typename T>
+static void UpdateGeometryBuffer(Context& context, Resource::Ptr& buffer, uint32_t bind_flag, const std::vector<T>& v)
+{
+    if (v.empty())
+        return;
+    uint64_t size = v.size() * sizeof(T);
+    uint64_t buffer_size = buffer ? context.GetBufferSize(buffer) : 0;
+    if (buffer_size < size)
+    {
+        buffer_size = std::max(size, 2 * buffer_size);
+        buffer = context.CreateBuffer(bind_flag | BindFlag::kCpuWrite, static_cast<uint32_t>(buffer_size), sizeof(T));
+    }
+    context.UpdateBuffer(buffer, 0, v.data(), size);
+}
+
 void ImGuiPass::OnUpdate()
 {
-    if (glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+    if (m_context.IsHeadless() || glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
         return;
 
     m_settings.NewFrame();
+    DrawGpuTimings();
 
     ImGui::Render();
 
@@ -68,18 +84,62 @@ void ImGuiPass::OnUpdate()
         }
     }
 
-    m_positions_buffer.get().reset(new IAVertexBuffer(m_context, positions));
-    m_texcoords_buffer.get().reset(new IAVertexBuffer(m_context, texcoords));
-    m_colors_buffer.get().reset(new IAVertexBuffer(m_context, colors));
-    m_indices_buffer.get().reset(new IAIndexBuffer(m_context, indices, gli::format::FORMAT_R32_UINT_PACK32));
+    UpdateGeometryBuffer(m_context, m_positions_buffer.get(), BindFlag::kVbv, positions);
+    UpdateGeometryBuffer(m_context, m_texcoords_buffer.get(), BindFlag::kVbv, texcoords);
+    UpdateGeometryBuffer(m_context, m_colors_buffer.get(), BindFlag::kVbv, colors);
+    UpdateGeometryBuffer(m_context, m_indices_buffer.get(), BindFlag::kIbv, indices);
+}
+
+static void DrawGpuTimingsNode(const GpuProfiler::Node& node)
+{
+    const char* fmt = "%s: %.3f ms (min %.3f, avg %.3f, max %.3f)";
+    if (node.children.empty())
+    {
+        ImGui::BulletText(fmt, node.name.c_str(), node.last_ms, node.min_ms, node.avg_ms, node.max_ms);
+        return;
+    }
+
+    ImGui::SetNextTreeNodeOpen(true, ImGuiCond_FirstUseEver);
+    if (ImGui::TreeNode(node.name.c_str(), fmt, node.name.c_str(), node.last_ms, node.min_ms, node.avg_ms, node.max_ms))
+    {
+        for (const auto& child : node.children)
+            DrawGpuTimingsNode(*child);
+        ImGui::TreePop();
+    }
+}
+
+void ImGuiPass::DrawGpuTimings()
+{
+    ImGui::Begin("GPU Timings");
+    const GpuProfiler& profiler = m_context.GetGpuProfiler();
+    DrawGpuTimingsNode(profiler.GetRoot());
+    const Context::AttachStats& attach_stats = m_context.GetAttachStats();
+    ImGui::Text("Attaches: %zu, skipped as unchanged: %zu", attach_stats.attaches, attach_stats.skipped_attaches);
+    const RenderGraph::Stats& graph_stats = m_input.render_graph.GetStats();
+    ImGui::Text("Render graph passes: %zu, culled: %zu", graph_stats.passes, graph_stats.culled_passes);
+    ImGui::Text("Transient textures: %zu, physical: %zu", graph_stats.transient_textures, graph_stats.physical_textures);
+    Context::MemoryStats memory_stats;
+    if (m_context.GetMemoryStats(memory_stats))
+    {
+        ImGui::Text("Memory: %.1f / %.1f MB used in %zu allocations, %zu blocks, %zu dedicated",
+            memory_stats.used_bytes / (1024.0 * 1024.0), memory_stats.reserved_bytes / (1024.0 * 1024.0),
+            memory_stats.allocations, memory_stats.memory_blocks, memory_stats.dedicated_allocations);
+        ImGui::Text("Descriptor sets: %zu (peak %zu) in %zu pools",
+            memory_stats.descriptor_sets, memory_stats.peak_descriptor_sets, memory_stats.descriptor_pools);
+    }
+    if (ImGui::Button("Dump to gpu_timings.json"))
+        profiler.DumpJson(std::string("gpu_timings.json"));
+    ImGui::End();
 }
 
 void ImGuiPass::OnRender()
 {
-    if (glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+    if (m_context.IsHeadless() || glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
         return;
 
     ImDrawData* draw_data = ImGui::GetDrawData();
+    if (!draw_data->TotalVtxCount)
+        return;
 
     m_context.UseProgram(m_program);
 
@@ -87,10 +147,10 @@ void ImGuiPass::OnRender()
 
     m_program.ps.om.rtv0.Attach(m_input.rtv);
 
-    m_indices_buffer.get()->Bind();
-    m_positions_buffer.get()->BindToSlot(m_program.vs.ia.POSITION);
-    m_texcoords_buffer.get()->BindToSlot(m_program.vs.ia.TEXCOORD);
-    m_colors_buffer.get()->BindToSlot(m_program.vs.ia.COLOR);
+    m_context.IASetIndexBuffer(m_indices_buffer.get(), gli::format::FORMAT_R32_UINT_PACK32);
+    m_context.IASetVertexBuffer(m_program.vs.ia.POSITION, m_positions_buffer.get());
+    m_context.IASetVertexBuffer(m_program.vs.ia.TEXCOORD, m_texcoords_buffer.get());
+    m_context.IASetVertexBuffer(m_program.vs.ia.COLOR, m_colors_buffer.get());
 
     m_program.ps.sampler.sampler0.Attach(m_sampler);
 
@@ -134,6 +194,12 @@ void ImGuiPass::OnResize(int width, int height)
     io.DisplaySize = ImVec2((float)m_width, (float)m_height);
 }
 
+void ImGuiPass::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.SetSideEffect();
+    builder.Write(m_input.rtv);
+}
+
 void ImGuiPass::OnKey(int key, int action)
 {
     if (glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) != GLFW_CURSOR_DISABLED)
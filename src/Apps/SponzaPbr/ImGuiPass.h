@@ -4,6 +4,7 @@
 #include <Scene/SceneBase.h>
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
+#include <RenderGraph/RenderGraph.h>
 #include <ProgramRef/ImGuiPassPS.h>
 #include <ProgramRef/ImGuiPassVS.h>
 #include "ImGuiSettings.h"
@@ -16,6 +17,7 @@ public:
     {
         Resource::Ptr& rtv;
         IModifySettings& root_scene;
+        const RenderGraph& render_graph;
     };
 
     struct Output
@@ -28,6 +30,7 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
     virtual void OnKey(int key, int action) override;
     virtual void OnMouse(bool first, double xpos, double ypos) override;
@@ -38,6 +41,7 @@ public:
 private:
     void CreateFontsTexture();
     void InitKey();
+    void DrawGpuTimings();
 
     Context& m_context;
     Input m_input;
@@ -46,10 +50,11 @@ private:
 
     Resource::Ptr m_font_texture_view;
     Program<ImGuiPassPS, ImGuiPassVS> m_program;
-    PerFrameData<std::unique_ptr<IAVertexBuffer>> m_positions_buffer;
-    PerFrameData<std::unique_ptr<IAVertexBuffer>> m_texcoords_buffer;
-    PerFrameData<std::unique_ptr<IAVertexBuffer>> m_colors_buffer;
-    PerFrameData<std::unique_ptr<IAIndexBuffer>> m_indices_buffer;
+    // CPU-visible geometry buffers, rewritten every frame and only recreated when they have to grow
+    PerFrameData<Resource::Ptr> m_positions_buffer;
+    PerFrameData<Resource::Ptr> m_texcoords_buffer;
+    PerFrameData<Resource::Ptr> m_colors_buffer;
+    PerFrameData<Resource::Ptr> m_indices_buffer;
     Resource::Ptr m_sampler;
     ImGuiSettings m_settings;
 };
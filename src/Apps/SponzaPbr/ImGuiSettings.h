@@ -60,6 +60,7 @@ public:
         add_checkbox("normal_mapping", settings.normal_mapping).BindKey(GLFW_KEY_N);
         add_checkbox("shadow_discard", settings.shadow_discard).BindKey(GLFW_KEY_J);
         add_checkbox("dynamic_sun_position", settings.dynamic_sun_position).BindKey(GLFW_KEY_SPACE);
+        add_checkbox("bindless materials", settings.use_bindless_materials);
     }
 
     void NewFrame()
@@ -161,3 +161,12 @@ void IrradianceConversion::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void IrradianceConversion::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.Read(m_input.environment);
+    builder.Write(m_input.irradince.res);
+    builder.Write(m_input.irradince.dsv);
+    builder.Write(m_input.prefilter.res);
+    builder.Write(m_input.prefilter.dsv);
+}
@@ -1,4 +1,5 @@
 #include "LightPass.h"
+#include <Texture/FormatHelper.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -13,7 +14,6 @@ LightPass::LightPass(Context& context, const Input& input, int width, int height
     m_input.camera.SetCameraYaw(-178.0f);
     m_input.camera.SetCameraYaw(-1.75f);
 
-    CreateSizeDependentResources();
     m_sampler = m_context.CreateSampler({
         SamplerFilter::kAnisotropic,
         SamplerTextureAddressMode::kWrap,
@@ -28,12 +28,22 @@ LightPass::LightPass(Context& context, const Input& input, int width, int height
         SamplerFilter::kComparisonMinMagMipLinear,
         SamplerTextureAddressMode::kClamp,
         SamplerComparisonFunc::kLess });
+
+    glm::vec4 white(1.0f);
+    size_t num_bytes = 0;
+    size_t row_bytes = 0;
+    GetFormatInfo(1, 1, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, num_bytes, row_bytes);
+    m_white_ao = m_context.CreateTexture(BindFlag::kSrv, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, 1, 1, 1);
+    m_context.UpdateSubresource(m_white_ao, 0, &white, row_bytes, num_bytes);
 }
 
 void LightPass::SetDefines(Program<LightPassPS, LightPassVS>& program)
 {
     if (m_settings.msaa_count != 1)
-        program.ps.define["SAMPLE_COUNT"] = std::to_string(m_settings.msaa_count);
+        program.ps.define["MULTISAMPLED"] = "1";
+    else
+        program.ps.define.erase("MULTISAMPLED");
+    program.ps.spec.SAMPLE_COUNT = m_settings.msaa_count;
 }
 
 void LightPass::OnUpdate()
@@ -126,6 +136,8 @@ void LightPass::OnRender()
             m_program.ps.srv.gSSAO.Attach(*m_input.ray_tracing_ao);
         else if (m_settings.use_ssao)
             m_program.ps.srv.gSSAO.Attach(m_input.ssao_pass.ao);
+        else
+            m_program.ps.srv.gSSAO.Attach(m_white_ao);
         m_program.ps.srv.irradianceMap.Attach(m_input.irradince);
         m_program.ps.srv.prefilterMap.Attach(m_input.prefilter);
         m_program.ps.srv.brdfLUT.Attach(m_input.brdf);
@@ -140,13 +152,25 @@ void LightPass::OnResize(int width, int height)
 {
     m_width = width;
     m_height = height;
-    CreateSizeDependentResources();
 }
 
-void LightPass::CreateSizeDependentResources()
+void LightPass::OnSetup(RenderGraph::PassBuilder& builder)
 {
-    output.rtv = m_context.CreateTexture(BindFlag::kRtv | BindFlag::kSrv, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_depth_stencil_view = m_context.CreateTexture(BindFlag::kDsv, gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, 1, m_width, m_height, 1);
+    builder.Read(m_input.geometry_pass.position);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.Read(m_input.geometry_pass.albedo);
+    builder.Read(m_input.geometry_pass.material);
+    if (m_settings.use_rtao && m_input.ray_tracing_ao)
+        builder.Read(*m_input.ray_tracing_ao);
+    else if (m_settings.use_ssao)
+        builder.Read(m_input.ssao_pass.ao);
+    if (m_settings.use_shadow)
+        builder.Read(m_input.shadow_pass.srv);
+    builder.Read(m_input.irradince);
+    builder.Read(m_input.prefilter);
+    builder.Read(m_input.brdf);
+    builder.Create(output.rtv, { BindFlag::kRtv | BindFlag::kSrv, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+    builder.Create(m_depth_stencil_view, { BindFlag::kDsv, gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, 1, m_width, m_height });
 }
 
 void LightPass::OnModifySettings(const Settings& settings)
@@ -155,8 +179,12 @@ void LightPass::OnModifySettings(const Settings& settings)
     m_settings = settings;
     if (prev.msaa_count != m_settings.msaa_count)
     {
-        m_program.ps.define["SAMPLE_COUNT"] = std::to_string(m_settings.msaa_count);
-        m_program.ps.UpdateShader();
-        m_program.LinkProgram();
+        SetDefines(m_program);
+        // Other sample counts only need another pipeline, Texture2D and Texture2DMS need another module
+        if ((prev.msaa_count != 1) != (m_settings.msaa_count != 1))
+        {
+            m_program.ps.UpdateShader();
+            m_program.LinkProgram();
+        }
     }
 }
@@ -40,9 +40,9 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
-    void CreateSizeDependentResources();
     void SetDefines(Program<LightPassPS, LightPassVS>& program);
 
     Settings m_settings;
@@ -55,4 +55,6 @@ private:
     Resource::Ptr m_sampler;
     Resource::Ptr m_sampler_brdf;
     Resource::Ptr m_compare_sampler;
+    // Bound as gSSAO without an AO pass, a stale binding would keep a retired render graph texture
+    Resource::Ptr m_white_ao;
 };
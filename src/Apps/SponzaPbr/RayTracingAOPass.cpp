@@ -128,3 +128,10 @@ void RayTracingAOPass::OnModifySettings(const Settings& settings)
         m_raytracing_program.LinkProgram();
     }
 }
+
+void RayTracingAOPass::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.Read(m_input.geometry_pass.position);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.Write(output.ao);
+}
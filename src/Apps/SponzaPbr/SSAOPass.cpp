@@ -19,8 +19,6 @@ SSAOPass::SSAOPass(Context& context, const Input& input, int width, int height)
     , m_program(context, std::bind(&SSAOPass::SetDefines, this, std::placeholders::_1))
     , m_program_blur(context)
 {
-    CreateSizeDependentResources();
-
     std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
     int kernel_size = m_program.ps.cbuffer.SSAOBuffer.samples.size();
@@ -74,7 +72,7 @@ void SSAOPass::OnRender()
     m_context.UseProgram(m_program);
 
     std::array<float, 4> color = { 0.0f, 0.0f, 0.0f, 1.0f };
-    m_program.ps.om.rtv0.Attach(m_ao).Clear(color);
+    m_program.ps.om.rtv0.Attach(m_settings.use_ao_blur ? m_ao : output.ao).Clear(color);
     m_program.ps.om.dsv.Attach(m_depth_stencil_view).Clear(ClearFlag::kDepth | ClearFlag::kStencil, 1.0f, 0);
 
     m_input.square.ia.indices.Bind();
@@ -92,7 +90,7 @@ void SSAOPass::OnRender()
     if (m_settings.use_ao_blur)
     {
         m_context.UseProgram(m_program_blur);
-        m_program_blur.ps.uav.out_uav.Attach(m_ao_blur);
+        m_program_blur.ps.uav.out_uav.Attach(output.ao);
         m_program_blur.ps.om.dsv.Attach(m_depth_stencil_view).Clear(ClearFlag::kDepth | ClearFlag::kStencil, 1.0f, 0);
 
         m_input.square.ia.indices.Bind();
@@ -103,12 +101,6 @@ void SSAOPass::OnRender()
             m_program_blur.ps.srv.ssaoInput.Attach(m_ao);
             m_context.DrawIndexed(range.index_count, range.start_index_location, range.base_vertex_location);
         }
-
-        output.ao = m_ao_blur;
-    }
-    else
-    {
-        output.ao = m_ao;
     }
 }
 
@@ -116,14 +108,18 @@ void SSAOPass::OnResize(int width, int height)
 {
     m_width = width;
     m_height = height;
-    CreateSizeDependentResources();
 }
 
-void SSAOPass::CreateSizeDependentResources()
+void SSAOPass::OnSetup(RenderGraph::PassBuilder& builder)
 {
-    m_ao = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_ao_blur = m_context.CreateTexture((BindFlag)(BindFlag::kRtv | BindFlag::kSrv | BindFlag::kUav), gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_depth_stencil_view = m_context.CreateTexture((BindFlag)(BindFlag::kDsv), gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, 1, m_width, m_height, 1);
+    builder.Read(m_input.geometry_pass.position);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.Create(output.ao, { BindFlag::kRtv | BindFlag::kSrv | BindFlag::kUav, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+    if (m_settings.use_ao_blur)
+        builder.Create(m_ao, { BindFlag::kRtv | BindFlag::kSrv, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+    else
+        m_ao.reset();
+    builder.Create(m_depth_stencil_view, { BindFlag::kDsv, gli::format::FORMAT_D24_UNORM_S8_UINT_PACK32, 1, m_width, m_height });
 }
 
 void SSAOPass::OnModifySettings(const Settings& settings)
@@ -132,14 +128,20 @@ void SSAOPass::OnModifySettings(const Settings& settings)
     m_settings = settings;
     if (prev.msaa_count != m_settings.msaa_count)
     {
-        m_program.ps.define["SAMPLE_COUNT"] = std::to_string(m_settings.msaa_count);
-        m_program.ps.UpdateShader();
-        m_program.LinkProgram();
+        SetDefines(m_program);
+        if ((prev.msaa_count != 1) != (m_settings.msaa_count != 1))
+        {
+            m_program.ps.UpdateShader();
+            m_program.LinkProgram();
+        }
     }
 }
 
 void SSAOPass::SetDefines(Program<SSAOPassPS, SSAOPassVS>& program)
 {
     if (m_settings.msaa_count != 1)
-        program.ps.define["SAMPLE_COUNT"] = std::to_string(m_settings.msaa_count);
+        program.ps.define["MULTISAMPLED"] = "1";
+    else
+        program.ps.define.erase("MULTISAMPLED");
+    program.ps.spec.SAMPLE_COUNT = m_settings.msaa_count;
 }
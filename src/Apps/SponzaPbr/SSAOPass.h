@@ -2,6 +2,7 @@
 
 #include "GeometryPass.h"
 #include "Settings.h"
+#include <RenderGraph/RenderGraph.h>
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
 #include <ProgramRef/SSAOPassPS.h>
@@ -29,10 +30,10 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     void SetDefines(Program<SSAOPassPS, SSAOPassVS>& program);
-    void CreateSizeDependentResources();
 
     Settings m_settings;
     Context& m_context;
@@ -43,6 +44,6 @@ private:
     Resource::Ptr m_depth_stencil_view;
     Program<SSAOPassPS, SSAOPassVS> m_program;
     Program<SSAOBlurPassPS, SSAOPassVS> m_program_blur;
+    // Unblurred AO, output.ao receives the blurred result
     Resource::Ptr m_ao;
-    Resource::Ptr m_ao_blur;
 };
@@ -12,6 +12,7 @@ Scene::Scene(Context& context, int width, int height)
     , m_height(height)
     , m_model_square(m_context, "model/square.obj")
     , m_model_cube(m_context, "model/cube.obj", ~aiProcess_FlipWindingOrder)
+    , m_render_graph(m_context)
     , m_skinning_pass(m_context, { m_scene_list }, width, height)
     , m_geometry_pass(m_context, { m_scene_list, m_camera }, width, height)
     , m_shadow_pass(m_context, { m_scene_list, m_camera, m_light_pos }, width, height)
@@ -22,7 +23,7 @@ Scene::Scene(Context& context, int width, int height)
     , m_light_pass(m_context, { m_geometry_pass.output, m_shadow_pass.output, m_ssao_pass.output, m_rtao, m_model_square, m_camera, m_light_pos, m_irradince, m_prefilter, m_brdf.output.brdf }, width, height)
     , m_background_pass(m_context, { m_model_cube, m_camera, m_equirectangular2cubemap.output.environment, m_light_pass.output.rtv, m_geometry_pass.output.dsv }, width, height)
     , m_compute_luminance(m_context, { m_light_pass.output.rtv, m_model_square, m_render_target_view, m_depth_stencil_view }, width, height)
-    , m_imgui_pass(m_context, { m_render_target_view, *this }, width, height)
+    , m_imgui_pass(m_context, { m_render_target_view, *this, m_render_graph }, width, height)
 {
 #if !defined(_DEBUG)
     m_scene_list.emplace_back(m_context, "model/sponza_pbr/sponza.obj");
@@ -55,6 +56,14 @@ Scene::Scene(Context& context, int width, int height)
     {
         m_scene_list.emplace_back(m_context, "model/pbr_test/" + test.first + "/sphere.obj");
         m_scene_list.back().matrix = glm::scale(glm::vec3(0.01f)) * glm::translate(glm::vec3(x, 500, 0.0f));
+        // With --instanced_spheres a 16x16 wall of copies is drawn with one instanced draw per range
+        if (CurState::Instance().instanced_spheres)
+        {
+            std::vector<glm::vec4> instances;
+            for (int i = 0; i < 16 * 16; ++i)
+                instances.emplace_back(0.0f, 50.0f * (i / 16), 50.0f * (i % 16), 1.0f);
+            m_scene_list.back().SetInstances(instances);
+        }
         m_scene_list.back().ibl_request = test.second;
         if (!test.second)
             m_scene_list.back().ibl_source = 0;
@@ -102,6 +111,8 @@ Scene::Scene(Context& context, int width, int height)
         m_rtao = &m_ray_tracing_ao_pass->output.ao;
     }
 #endif
+
+    BuildRenderGraph();
 }
 
 Scene::~Scene()
@@ -157,68 +168,7 @@ void Scene::OnRender()
     m_render_target_view = m_context.GetBackBuffer();
     m_camera.SetViewport(m_width, m_height);
 
-    m_context.BeginEvent("Skinning Pass");
-    m_skinning_pass.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("Geometry Pass");
-    m_geometry_pass.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("Shadow Pass");
-    m_shadow_pass.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("SSAO Pass");
-    m_ssao_pass.OnRender();
-    m_context.EndEvent();
-
-#ifdef RAYTRACING_SUPPORT
-    if (m_ray_tracing_ao_pass)
-    {
-        m_context.BeginEvent("DXR AO Pass");
-        m_ray_tracing_ao_pass->OnRender();
-        m_context.EndEvent();
-    }
-#endif
-
-    m_context.BeginEvent("brdf Pass");
-    m_brdf.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("equirectangular to cubemap Pass");
-    m_equirectangular2cubemap.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("IBLCompute");
-    m_ibl_compute.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("Irradiance Conversion Pass");
-    for (auto& x : m_irradiance_conversion)
-    {
-        x->OnRender();
-    }
-    m_context.EndEvent();
-
-    m_context.BeginEvent("Light Pass");
-    m_light_pass.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("Background Pass");
-    m_background_pass.OnRender();
-    m_context.EndEvent();
-
-    m_context.BeginEvent("HDR Pass");
-    m_compute_luminance.OnRender();
-    m_context.EndEvent();
-
-    if (glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) != GLFW_CURSOR_DISABLED)
-    {
-        m_context.BeginEvent("ImGui Pass");
-        m_imgui_pass.OnRender();
-        m_context.EndEvent();
-    }
+    m_render_graph.Execute();
 
     m_context.Present();
 }
@@ -245,6 +195,8 @@ void Scene::OnResize(int width, int height)
     m_light_pass.OnResize(width, height);
     m_compute_luminance.OnResize(width, height);
     m_imgui_pass.OnResize(width, height);
+
+    BuildRenderGraph();
 }
 
 void Scene::OnKey(int key, int action)
@@ -327,6 +279,8 @@ void Scene::OnModifySettings(const Settings& settings)
         x->OnModifySettings(settings);
     }
     m_background_pass.OnModifySettings(settings);
+
+    BuildRenderGraph();
 }
 
 void Scene::CreateRT()
@@ -341,3 +295,85 @@ void Scene::CreateRT()
     m_depth_stencil_view_irradince = m_context.CreateTexture((BindFlag)(BindFlag::kDsv), gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_irradince_texture_size, m_irradince_texture_size, 6 * m_ibl_count);
     m_depth_stencil_view_prefilter = m_context.CreateTexture((BindFlag)(BindFlag::kDsv), gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_prefilter_texture_size, m_prefilter_texture_size, 6 * m_ibl_count, log2(m_prefilter_texture_size));
 }
+
+void Scene::BuildRenderGraph()
+{
+    m_render_graph.Reset();
+
+    m_render_graph.AddPass("Skinning Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_skinning_pass.OnSetup(builder); },
+        [&] { m_skinning_pass.OnRender(); });
+
+    m_render_graph.AddPass("Geometry Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_geometry_pass.OnSetup(builder); },
+        [&] {
+            m_context.WaitAsyncCompute();
+            m_geometry_pass.OnRender();
+        });
+
+    m_render_graph.AddPass("Shadow Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_shadow_pass.OnSetup(builder); },
+        [&] { m_shadow_pass.OnRender(); });
+
+    m_render_graph.AddPass("SSAO Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_ssao_pass.OnSetup(builder); },
+        [&] { m_ssao_pass.OnRender(); });
+
+#ifdef RAYTRACING_SUPPORT
+    if (m_ray_tracing_ao_pass)
+    {
+        m_render_graph.AddPass("DXR AO Pass",
+            [&](RenderGraph::PassBuilder& builder) { m_ray_tracing_ao_pass->OnSetup(builder); },
+            [&] { m_ray_tracing_ao_pass->OnRender(); });
+    }
+#endif
+
+    m_render_graph.AddPass("brdf Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_brdf.OnSetup(builder); },
+        [&] { m_brdf.OnRender(); });
+
+    m_render_graph.AddPass("equirectangular to cubemap Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_equirectangular2cubemap.OnSetup(builder); },
+        [&] { m_equirectangular2cubemap.OnRender(); });
+
+    m_render_graph.AddPass("IBLCompute",
+        [&](RenderGraph::PassBuilder& builder) { m_ibl_compute.OnSetup(builder); },
+        [&] { m_ibl_compute.OnRender(); });
+
+    m_render_graph.AddPass("Irradiance Conversion Pass",
+        [&](RenderGraph::PassBuilder& builder)
+        {
+            for (auto& x : m_irradiance_conversion)
+            {
+                x->OnSetup(builder);
+            }
+        },
+        [&] {
+            m_context.WaitAsyncCompute();
+            for (auto& x : m_irradiance_conversion)
+            {
+                x->OnRender();
+            }
+        });
+
+    m_render_graph.AddPass("Light Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_light_pass.OnSetup(builder); },
+        [&] { m_light_pass.OnRender(); });
+
+    m_render_graph.AddPass("Background Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_background_pass.OnSetup(builder); },
+        [&] { m_background_pass.OnRender(); });
+
+    m_render_graph.AddPass("HDR Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_compute_luminance.OnSetup(builder); },
+        [&] { m_compute_luminance.OnRender(); });
+
+    m_render_graph.AddPass("ImGui Pass",
+        [&](RenderGraph::PassBuilder& builder) { m_imgui_pass.OnSetup(builder); },
+        [&] {
+            if (!m_context.IsHeadless() && glfwGetInputMode(m_context.GetWindow(), GLFW_CURSOR) != GLFW_CURSOR_DISABLED)
+                m_imgui_pass.OnRender();
+        });
+
+    m_render_graph.Compile();
+}
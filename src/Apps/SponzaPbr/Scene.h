@@ -24,6 +24,7 @@
 #include "IBLCompute.h"
 #include "BRDFGen.h"
 #include "Equirectangular2Cubemap.h"
+#include <RenderGraph/RenderGraph.h>
 
 #ifdef RAYTRACING_SUPPORT
 #include "RayTracingAOPass.h"
@@ -50,6 +51,7 @@ public:
 
 private:
     void CreateRT();
+    void BuildRenderGraph();
 
     Context& m_context;
 
@@ -65,6 +67,7 @@ private:
     SceneModels m_scene_list;
     Model m_model_square;
     Model m_model_cube;
+    RenderGraph m_render_graph;
     SkinningPass m_skinning_pass;
     GeometryPass m_geometry_pass;
     ShadowPass m_shadow_pass;
@@ -45,4 +45,5 @@ Settings::Settings()
     normal_mapping = true;
     shadow_discard = true;
     dynamic_sun_position = false;
+    use_bindless_materials = false;
 }
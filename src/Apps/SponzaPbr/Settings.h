@@ -49,6 +49,7 @@ public:
     bool normal_mapping;
     bool shadow_discard;
     bool dynamic_sun_position;
+    bool use_bindless_materials;
 };
 
 class IModifySettings
@@ -7,6 +7,7 @@ ShadowPass::ShadowPass(Context& context, const Input& input, int width, int heig
     : m_context(context)
     , m_input(input)
     , m_program(context)
+    , m_task_programs(context, &m_program)
 {
     CreateSizeDependentResources();
     m_sampler = m_context.CreateSampler({
@@ -51,30 +52,66 @@ void ShadowPass::OnRender()
     m_program.ps.sampler.g_sampler.Attach(m_sampler);
 
     std::array<float, 4> color = { 0.0f, 0.0f, 0.0f, 1.0f };
+    m_program.SetRasterizeState({ FillMode::kSolid, CullMode::kBack, 4096 });
     m_program.ps.om.dsv.Attach(output.srv).Clear(ClearFlag::kDepth | ClearFlag::kStencil, 1.0f, 0);
 
+    // Without alpha testing the bindings don't change between ranges, so a single copy model is drawn with one indirect draw
+    std::vector<std::pair<Model*, const MeshRange*>> draws;
     for (auto& model : m_input.scene_list)
     {
-        m_program.vs.cbuffer.VSParams.World = glm::transpose(model.matrix);
-
-        m_program.SetRasterizeState({ FillMode::kSolid, CullMode::kBack, 4096 });
-
-        model.ia.indices.Bind();
-        model.ia.positions.BindToSlot(m_program.vs.ia.SV_POSITION);
-        model.ia.texcoords.BindToSlot(m_program.vs.ia.TEXCOORD);
-
+        if (!m_settings.shadow_discard && model.instances.Count() == 1)
+        {
+            draws.emplace_back(&model, nullptr);
+            continue;
+        }
         for (auto& range : model.ia.ranges)
+            draws.emplace_back(&model, &range);
+    }
+
+    size_t task_count = m_task_programs.Prepare(draws.size());
+    m_context.ExecuteInParallel(task_count, [&](size_t task)
+    {
+        auto& program = m_task_programs.Get(task);
+        m_context.UseProgram(program);
+
+        program.gs.cbuffer.GSParams.Projection = m_program.gs.cbuffer.GSParams.Projection;
+        program.gs.cbuffer.GSParams.View = m_program.gs.cbuffer.GSParams.View;
+        program.SetRasterizeState({ FillMode::kSolid, CullMode::kBack, 4096 });
+        program.ps.sampler.g_sampler.Attach(m_sampler);
+        program.ps.om.dsv.Attach(output.srv);
+
+        Model* bound_model = nullptr;
+        size_t end = m_task_programs.GetEndDraw(task, draws.size());
+        for (size_t i = m_task_programs.GetFirstDraw(task); i < end; ++i)
         {
+            Model& model = *draws[i].first;
+            if (bound_model != &model)
+            {
+                bound_model = &model;
+                program.vs.cbuffer.VSParams.World = glm::transpose(model.matrix);
+
+                model.ia.indices.Bind();
+                model.ia.positions.BindToSlot(program.vs.ia.SV_POSITION);
+                model.ia.texcoords.BindToSlot(program.vs.ia.TEXCOORD);
+                model.instances.BindToSlot(program.vs.ia.INSTANCE_OFFSET);
+            }
+
+            if (!draws[i].second)
+            {
+                program.ps.srv.alphaMap.Attach();
+                m_context.DrawIndexedIndirect(model.ia.indirect_args, 0, static_cast<uint32_t>(model.ia.ranges.size()));
+                continue;
+            }
+
+            const MeshRange& range = *draws[i].second;
             auto& material = model.GetMaterial(range.id);
-
             if (m_settings.shadow_discard)
-                m_program.ps.srv.alphaMap.Attach(material.texture.opacity);
+                program.ps.srv.alphaMap.Attach(material.texture.opacity);
             else
-                m_program.ps.srv.alphaMap.Attach();
-
-            m_context.DrawIndexed(range.index_count, range.start_index_location, range.base_vertex_location);
+                program.ps.srv.alphaMap.Attach();
+            m_context.DrawIndexedInstanced(range.index_count, model.instances.Count(), range.start_index_location, range.base_vertex_location, 0);
         }
-    }
+    });
 }
 
 void ShadowPass::OnResize(int width, int height)
@@ -83,10 +120,15 @@ void ShadowPass::OnResize(int width, int height)
 
 void ShadowPass::CreateSizeDependentResources()
 {
-    output.srv = m_context.CreateTexture(BindFlag::kDsv | BindFlag::kSrv, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_settings.s_size, m_settings.s_size, 6);
     m_buffer = m_context.CreateBuffer((BindFlag)(BindFlag::kRtv), sizeof(float) * m_settings.s_size * m_settings.s_size, 0);
 }
 
+void ShadowPass::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    int size = static_cast<int>(m_settings.s_size);
+    builder.Create(output.srv, { BindFlag::kDsv | BindFlag::kSrv, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, size, size, 6 });
+}
+
 void ShadowPass::OnModifySettings(const Settings& settings)
 {
     Settings prev = m_settings;
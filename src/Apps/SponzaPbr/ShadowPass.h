@@ -7,6 +7,8 @@
 #include <ProgramRef/ShadowPassGS.h>
 #include <ProgramRef/ShadowPassPS.h>
 #include "Settings.h"
+#include "TaskPrograms.h"
+#include <RenderGraph/RenderGraph.h>
 
 class ShadowPass : public IPass, public IModifySettings
 {
@@ -29,6 +31,7 @@ public:
     virtual void OnRender() override;
     virtual void OnResize(int width, int height) override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     void CreateSizeDependentResources();
@@ -37,6 +40,7 @@ private:
     Context& m_context;
     Input m_input;
     Program<ShadowPassVS, ShadowPassGS, ShadowPassPS> m_program;
+    TaskPrograms<Program<ShadowPassVS, ShadowPassGS, ShadowPassPS>> m_task_programs;
     Resource::Ptr m_buffer;
     Resource::Ptr m_sampler;
 };
@@ -13,6 +13,7 @@ void SkinningPass::OnUpdate()
 
 void SkinningPass::OnRender()
 {
+    m_context.BeginAsyncCompute();
     m_context.UseProgram(m_program);
 
     for (auto& model : m_input.scene_list)
@@ -46,9 +47,15 @@ void SkinningPass::OnRender()
             m_context.Dispatch((range.index_count + 256 - 1) / 256, 1, 1);
         }
     }
+    m_context.EndAsyncCompute();
 }
 
 void SkinningPass::OnModifySettings(const Settings& settings)
 {
     m_settings = settings;
 }
+
+void SkinningPass::OnSetup(RenderGraph::PassBuilder& builder)
+{
+    builder.SetSideEffect();
+}
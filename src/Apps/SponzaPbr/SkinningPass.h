@@ -4,6 +4,7 @@
 #include "Settings.h"
 #include <Context/Context.h>
 #include <Geometry/Geometry.h>
+#include <RenderGraph/RenderGraph.h>
 #include <ProgramRef/SkinningCS.h>
 
 class SkinningPass : public IPass, public IModifySettings
@@ -23,6 +24,7 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender() override;
     virtual void OnModifySettings(const Settings & settings) override;
+    void OnSetup(RenderGraph::PassBuilder& builder);
 
 private:
     Settings m_settings;
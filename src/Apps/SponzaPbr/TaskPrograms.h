@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Context/Context.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Draws are recorded in chunks of kDrawsPerTask through Context::ExecuteInParallel, every chunk through its own program.
+// Contexts without parallel recording run the chunks in order, all of them then share the pass program.
+template<typename ProgramType>
+class TaskPrograms
+{
+public:
+    static constexpr size_t kDrawsPerTask = 64;
+
+    // Without a pass program a single shared program is created on first use
+    TaskPrograms(Context& context, ProgramType* pass_program = nullptr)
+        : m_context(context)
+        , m_pass_program(pass_program)
+    {
+    }
+
+    // Returns the task count for draw_count draws, creating the programs the tasks need
+    size_t Prepare(size_t draw_count)
+    {
+        size_t task_count = (draw_count + kDrawsPerTask - 1) / kDrawsPerTask;
+        size_t program_count = task_count;
+        if (!m_context.IsParallelRecordingSupported())
+            program_count = m_pass_program ? 0 : std::min<size_t>(task_count, 1);
+        while (m_programs.size() < program_count)
+            m_programs.emplace_back(new ProgramType(m_context));
+        // Shaders compile asynchronously, tasks may run on worker threads which must not create backend objects
+        for (size_t i = 0; i < program_count; ++i)
+            m_programs[i]->FinishCompilation();
+        return task_count;
+    }
+
+    // Index of the program used by the task, tasks sharing a program share the index
+    size_t GetIndex(size_t task) const
+    {
+        return m_context.IsParallelRecordingSupported() ? task : 0;
+    }
+
+    // Programs created so far, indices of tasks are below this count unless the pass program is used
+    size_t GetCreatedCount() const
+    {
+        return m_programs.size();
+    }
+
+    ProgramType& Get(size_t task)
+    {
+        if (!m_context.IsParallelRecordingSupported() && m_pass_program)
+            return *m_pass_program;
+        return *m_programs[GetIndex(task)];
+    }
+
+    static size_t GetFirstDraw(size_t task)
+    {
+        return task * kDrawsPerTask;
+    }
+
+    static size_t GetEndDraw(size_t task, size_t draw_count)
+    {
+        return std::min(draw_count, (task + 1) * kDrawsPerTask);
+    }
+
+private:
+    Context& m_context;
+    ProgramType* m_pass_program;
+    std::vector<std::unique_ptr<ProgramType>> m_programs;
+};
@@ -1,7 +1,11 @@
 #include "AppBox/AppBox.h"
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <iostream>
 #include <sstream>
 #include <Context/ContextSelector.h>
+#include <Program/ProgramApi.h>
+#include <Shader/ShaderWatcher.h>
 #include <Utilities/State.h>
 
 AppBox::AppBox(int argc, char* argv[], const std::string& title)
@@ -20,6 +24,8 @@ AppBox::AppBox(int argc, char* argv[], const CreateSample& create_sample, const
     , m_width(0)
     , m_height(0)
     , m_exit(false)
+    , m_headless(false)
+    , m_frame_limit(0)
 {
     for (int i = 1; i < argc; ++i)
     {
@@ -36,8 +42,20 @@ AppBox::AppBox(int argc, char* argv[], const CreateSample& create_sample, const
             CurState::Instance().required_gpu_index = std::stoul(argv[++i]);
         else if (arg == "--no_vsync")
             CurState::Instance().vsync = false;
+        else if (arg == "--frames_in_flight")
+            CurState::Instance().frames_in_flight = std::stoul(argv[++i]);
         else if (arg == "--force_dxil")
             CurState::Instance().force_dxil = true;
+        else if (arg == "--hot_reload")
+            CurState::Instance().shader_hot_reload = true;
+        else if (arg == "--instanced_spheres")
+            CurState::Instance().instanced_spheres = true;
+        else if (arg == "--headless")
+            m_headless = true;
+        else if (arg == "--frames")
+            m_frame_limit = std::stoul(argv[++i]);
+        else if (arg == "--gpu_timings")
+            m_gpu_timings_path = argv[++i];
     }
 
     std::string api_title;
@@ -58,9 +76,17 @@ AppBox::AppBox(int argc, char* argv[], const CreateSample& create_sample, const
     }
     m_title = api_title + " " + title;
 
-    auto monitor_desc = GetPrimaryMonitorRect();
-    m_width = monitor_desc.width / 1.5;
-    m_height = monitor_desc.height / 1.5;
+    if (m_headless)
+    {
+        m_width = kHeadlessWidth;
+        m_height = kHeadlessHeight;
+    }
+    else
+    {
+        auto monitor_desc = GetPrimaryMonitorRect();
+        m_width = monitor_desc.width / 1.5;
+        m_height = monitor_desc.height / 1.5;
+    }
 
     Init();
 }
@@ -73,44 +99,54 @@ AppBox::AppBox(const CreateSample& create_sample, ApiType api_type, const std::s
     , m_width(width)
     , m_height(height)
     , m_exit(false)
+    , m_headless(false)
+    , m_frame_limit(0)
 {
     Init();
 }
 
 AppBox::~AppBox()
 {
+    m_sample.reset();
     if (m_window)
-    {
-        m_sample.reset();
         glfwDestroyWindow(m_window);
-    }
 
     glfwTerminate();
 }
 
 int AppBox::Run()
 {
-    if (!m_window)
+    if (!m_context)
         return EXIT_FAILURE;
 
+    // glfwGetTime is unavailable when GLFW fails to initialize without a display server
+    using clock = std::chrono::steady_clock;
     int frame_number = 0;
-    double last_time = glfwGetTime();
-    while (!glfwWindowShouldClose(m_window))
+    size_t total_frames = 0;
+    auto last_time = clock::now();
+    while (!ShouldClose())
     {
-        glfwPollEvents();
+        PollEvents();
 
         if (m_exit)
             break;
 
+        // Shaders changed on disk compile in the background and are swapped in between frames
+        ShaderWatcher::Instance().Poll();
+        ProgramApi::ApplyReloads();
+
         if (m_sample)
         {
             m_sample->OnUpdate();
             m_sample->OnRender();
         }
 
+        if (m_frame_limit && ++total_frames >= m_frame_limit)
+            m_exit = true;
+
         ++frame_number;
-        double current_time = glfwGetTime();
-        double delta = current_time - last_time;
+        auto current_time = clock::now();
+        double delta = std::chrono::duration<double>(current_time - last_time).count();
         if (delta >= 1.0)
         {
             double fps = double(frame_number) / delta;
@@ -118,24 +154,31 @@ int AppBox::Run()
             std::stringstream ss;
             ss << m_title<< " [" << fps << " FPS]";
 
-            glfwSetWindowTitle(m_window, ss.str().c_str());
+            if (m_window)
+                glfwSetWindowTitle(m_window, ss.str().c_str());
+            else
+                std::cout << ss.str() << std::endl;
 
             frame_number = 0;
             last_time = current_time;
         }
     }
 
+    if (!m_gpu_timings_path.empty() && !m_context->GetGpuProfiler().DumpJson(m_gpu_timings_path))
+        std::cerr << "Failed to write " << m_gpu_timings_path << std::endl;
+
     return EXIT_SUCCESS;
 }
 
 bool AppBox::ShouldClose()
 {
-    return glfwWindowShouldClose(m_window) || m_exit;
+    return (m_window && glfwWindowShouldClose(m_window)) || m_exit;
 }
 
 void AppBox::PollEvents()
 {
-    glfwPollEvents();
+    if (m_window)
+        glfwPollEvents();
 }
 
 Context& AppBox::GetContext()
@@ -158,12 +201,24 @@ AppRect AppBox::GetPrimaryMonitorRect()
 
 void AppBox::Init()
 {
-    if (!glfwInit())
-        return;
-
-    InitWindow();
-    SetWindowToCenter();
-    m_context = CreateContext(m_api_type, m_window);
+    if (m_headless)
+    {
+        // No window and no surface. glfwInit may fail without a display server, the frame timer does not depend on it,
+        // only scene code reading glfwGetTime then sees a stopped clock
+        glfwInit();
+        m_context = CreateContext(m_api_type, nullptr, m_width, m_height);
+    }
+    else
+    {
+        if (!glfwInit())
+            return;
+
+        InitWindow();
+        if (!m_window)
+            return;
+        SetWindowToCenter();
+        m_context = CreateContext(m_api_type, m_window);
+    }
     if (m_create_sample)
         m_sample = m_create_sample(*m_context, m_width, m_height);
 }
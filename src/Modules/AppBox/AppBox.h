@@ -31,6 +31,9 @@ public:
     static AppRect GetPrimaryMonitorRect();
 
 private:
+    static constexpr int kHeadlessWidth = 1280;
+    static constexpr int kHeadlessHeight = 720;
+
     void Init();
     void InitWindow();
     void SetWindowToCenter();
@@ -50,5 +53,10 @@ private:
     int m_width;
     int m_height;
     bool m_exit;
+    // --headless renders offscreen without a window, --frames exits after the given number of frames
+    bool m_headless;
+    size_t m_frame_limit;
+    // --gpu_timings writes the per-pass GPU timings as JSON to the given path on exit
+    std::string m_gpu_timings_path;
     std::unique_ptr<Context> m_context;
 };
@@ -29,6 +29,18 @@ struct SamplerDesc
     SamplerFilter filter;
     SamplerTextureAddressMode mode;
     SamplerComparisonFunc func;
+
+private:
+    auto MakeTie() const
+    {
+        return std::tie(filter, mode, func);
+    }
+
+public:
+    bool operator< (const SamplerDesc& oth) const
+    {
+        return MakeTie() < oth.MakeTie();
+    }
 };
 
 enum class ResourceType
@@ -53,6 +65,19 @@ enum BindFlag
     kVbv = 1 << 7,
     kSampler = 1 << 8,
     KAccelerationStructure = 1 << 9,
+    kCpuWrite = 1 << 10,
+    kIndirect = 1 << 11,
+};
+
+// Layout of one draw in the argument buffer of Context::DrawIndexedIndirect,
+// matches VkDrawIndexedIndirectCommand, DrawElementsIndirectCommand and D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawIndexedIndirectCommand
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
 };
 
 enum ClearFlag
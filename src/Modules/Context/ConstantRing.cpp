@@ -0,0 +1,59 @@
+#include "Context/ConstantRing.h"
+#include "Context/Context.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+ConstantRing::ConstantRing(Context& context, size_t frame_count, uint64_t alignment)
+    : m_context(context)
+    , m_alignment(std::max<uint64_t>(alignment, 1))
+    , m_slots(frame_count)
+{
+}
+
+ConstantRing::Range ConstantRing::Allocate(const void* data, uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Slot& slot = m_slots[m_frame];
+
+    // Chunks are only appended while the ring grows, a steady frame reuses the chunks of its slot
+    uint64_t offset = (slot.offset + m_alignment - 1) / m_alignment * m_alignment;
+    while (slot.chunk_index < slot.chunks.size() && offset + size > slot.chunks[slot.chunk_index].size)
+    {
+        ++slot.chunk_index;
+        offset = 0;
+    }
+    if (slot.chunk_index == slot.chunks.size())
+    {
+        Chunk chunk;
+        chunk.size = std::max(kChunkSize, size);
+        chunk.buffer = m_context.CreateBuffer(BindFlag::kCbv | BindFlag::kCpuWrite, static_cast<uint32_t>(chunk.size), 0);
+        chunk.mapped = m_context.MapBuffer(chunk.buffer);
+        if (!chunk.mapped)
+            throw std::runtime_error("Constant ring requires persistently mapped constant buffers");
+        slot.chunks.push_back(chunk);
+        offset = 0;
+    }
+
+    Chunk& chunk = slot.chunks[slot.chunk_index];
+    memcpy(chunk.mapped + offset, data, size);
+    m_context.FlushBuffer(chunk.buffer, offset, size);
+    slot.offset = offset + size;
+
+    return { chunk.buffer, offset, size, m_epoch };
+}
+
+bool ConstantRing::IsCurrent(const Range& range) const
+{
+    return range.buffer && range.epoch == m_epoch;
+}
+
+void ConstantRing::OnFrameBegin(size_t frame)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frame = frame;
+    Slot& slot = m_slots[m_frame];
+    slot.chunk_index = 0;
+    slot.offset = 0;
+    ++m_epoch;
+}
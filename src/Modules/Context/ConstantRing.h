@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <Resource/Resource.h>
+
+class Context;
+
+// Linear per-frame allocator for constant buffer data.
+// Every frame slot owns a list of persistently mapped chunks whose offsets restart when the slot becomes current again.
+class ConstantRing
+{
+public:
+    struct Range
+    {
+        Resource::Ptr buffer;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t epoch = 0;
+    };
+
+    ConstantRing(Context& context, size_t frame_count, uint64_t alignment);
+
+    Range Allocate(const void* data, uint64_t size);
+    // Ranges stay valid until the next OnFrameBegin
+    bool IsCurrent(const Range& range) const;
+    // Makes the slot of the frame current, the frame that used it before must be complete on the GPU
+    void OnFrameBegin(size_t frame);
+
+private:
+    static constexpr uint64_t kChunkSize = 1 << 20;
+
+    struct Chunk
+    {
+        Resource::Ptr buffer;
+        uint8_t* mapped = nullptr;
+        uint64_t size = 0;
+    };
+
+    struct Slot
+    {
+        std::vector<Chunk> chunks;
+        size_t chunk_index = 0;
+        uint64_t offset = 0;
+    };
+
+    Context& m_context;
+    uint64_t m_alignment;
+    std::vector<Slot> m_slots;
+    size_t m_frame = 0;
+    uint64_t m_epoch = 1;
+    std::mutex m_mutex;
+};
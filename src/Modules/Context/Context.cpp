@@ -1,11 +1,15 @@
 #include "Context/Context.h"
+#include <cstring>
+#include <stdexcept>
 
-Context::Context(GLFWwindow* window)
+Context::Context(GLFWwindow* window, int width, int height)
     : m_window(window)
-    , m_width(0)
-    , m_height(0)
+    , m_width(width)
+    , m_height(height)
+    , m_gpu_profiler(FrameCount)
 {
-    glfwGetWindowSize(window, &m_width, &m_height);
+    if (m_window)
+        glfwGetWindowSize(m_window, &m_width, &m_height);
 }
 
 void Context::OnResize(int width, int height)
@@ -15,6 +19,34 @@ void Context::OnResize(int width, int height)
     ResizeBackBuffer(m_width, m_height);
 }
 
+void Context::UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size)
+{
+    uint8_t* ptr = MapBuffer(ires);
+    if (!ptr)
+        throw std::runtime_error("UpdateBuffer is not supported for this buffer");
+    CheckBufferRange(ires, offset, size);
+    memcpy(ptr + offset, pSrcData, size);
+    FlushBuffer(ires, offset, size);
+}
+
+void Context::CheckBufferRange(const Resource::Ptr& ires, uint64_t offset, uint64_t size) const
+{
+    uint64_t buffer_size = GetBufferSize(ires);
+    if (offset > buffer_size || size > buffer_size - offset)
+        throw std::runtime_error("UpdateBuffer range exceeds the buffer");
+}
+
+void Context::DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation)
+{
+    DrawIndexedInstanced(IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0);
+}
+
+void Context::ExecuteInParallel(size_t task_count, const std::function<void(size_t task)>& task)
+{
+    for (size_t i = 0; i < task_count; ++i)
+        task(i);
+}
+
 size_t Context::GetFrameIndex() const
 {
     return m_frame_index;
@@ -25,6 +57,34 @@ GLFWwindow* Context::GetWindow()
     return m_window;
 }
 
+bool Context::IsHeadless() const
+{
+    return !m_window;
+}
+
+const GpuProfiler& Context::GetGpuProfiler() const
+{
+    return m_gpu_profiler;
+}
+
+const Context::AttachStats& Context::GetAttachStats() const
+{
+    return m_attach_stats;
+}
+
+void Context::CountAttach(bool skipped)
+{
+    ++m_attaches;
+    if (skipped)
+        ++m_skipped_attaches;
+}
+
+void Context::UpdateAttachStats()
+{
+    m_attach_stats.attaches = m_attaches.exchange(0);
+    m_attach_stats.skipped_attaches = m_skipped_attaches.exchange(0);
+}
+
 Resource::Ptr Context::CreateBottomLevelAS(const BufferDesc & vertex)
 {
     return Resource::Ptr();
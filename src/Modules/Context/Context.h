@@ -3,9 +3,12 @@
 #include <GLFW/glfw3.h>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <functional>
 
 #include <Program/ProgramApi.h>
 #include "Context/BaseTypes.h"
+#include "Context/GpuProfiler.h"
 #include <Resource/Resource.h>
 #include <glm/glm.hpp>
 #include <gli/gli.hpp>
@@ -13,7 +16,8 @@
 class Context
 {
 public:
-    Context(GLFWwindow* window);
+    // Without a window the context is headless and renders into offscreen back buffers of width x height
+    Context(GLFWwindow* window, int width = 0, int height = 0);
     virtual ~Context() {}
 
     virtual std::unique_ptr<ProgramApi> CreateProgram() = 0;
@@ -24,6 +28,16 @@ public:
     virtual Resource::Ptr CreateBottomLevelAS(const BufferDesc& vertex, const BufferDesc& index);
     virtual Resource::Ptr CreateTopLevelAS(const std::vector<std::pair<Resource::Ptr, glm::mat4>>& geometry);
     virtual void UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubresource, const void *pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch) = 0;
+    // Throws std::runtime_error when the range doesn't fit into the buffer
+    virtual void UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size);
+    // Persistently mapped pointer for buffers created with kCpuWrite or kCbv, nullptr otherwise.
+    // Writes become visible to the GPU after FlushBuffer for the written range.
+    // Writes are not synchronized with the GPU, which may still read the buffer for up to FrameCount - 1
+    // frames in flight. A buffer rewritten every frame has to be ring-buffered, e.g. with PerFrameData.
+    virtual uint8_t* MapBuffer(const Resource::Ptr& ires) { return nullptr; }
+    virtual void FlushBuffer(const Resource::Ptr& ires, uint64_t offset, uint64_t size) {}
+    // Size in bytes of a buffer, 0 when the backend doesn't track it
+    virtual uint64_t GetBufferSize(const Resource::Ptr& ires) const { return 0; }
 
     virtual void SetViewport(float width, float height) = 0;
     virtual void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom) = 0;
@@ -33,10 +47,33 @@ public:
 
     virtual void UseProgram(ProgramApi& program) = 0;
 
+    // Events also write GPU timestamps on backends that support them, see GetGpuProfiler
     virtual void BeginEvent(const std::string& name) = 0;
     virtual void EndEvent() = 0;
 
-    virtual void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation) = 0;
+    // Dispatches recorded between BeginAsyncCompute and EndAsyncCompute run on a separate compute queue
+    // when the device has one, overlapping graphics work recorded until WaitAsyncCompute.
+    // Without a compute queue the section is recorded inline and the calls do nothing.
+    // Resources written inside a section must not be used by graphics work before WaitAsyncCompute.
+    virtual bool IsAsyncComputeSupported() const { return false; }
+    virtual void BeginAsyncCompute() {}
+    virtual void EndAsyncCompute() {}
+    virtual void WaitAsyncCompute() {}
+
+    // Runs task(i) for every i in [0, task_count), on worker threads where the backend supports it.
+    // Draws of a task are executed in task order inside the render pass of the program current on
+    // the calling thread, which also performs its clears. Every task has to use its own program
+    // attached to the same render targets, and must not change the layout of any resource.
+    // Without parallel recording the tasks run in order on the calling thread and may share one program.
+    virtual bool IsParallelRecordingSupported() const { return false; }
+    virtual void ExecuteInParallel(size_t task_count, const std::function<void(size_t task)>& task);
+
+    void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation);
+    // Vertex inputs with an INSTANCE_ semantic advance once per instance, starting at element StartInstanceLocation
+    virtual void DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) = 0;
+    // Issues draw_count indexed draws whose arguments are read from a kIndirect buffer starting at offset,
+    // one DrawIndexedIndirectCommand per draw. All draws share the bindings of the current program.
+    virtual void DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count) = 0;
     virtual void Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ) = 0;
     virtual void DispatchRays(uint32_t width, uint32_t height, uint32_t depth) {}
 
@@ -44,21 +81,59 @@ public:
     virtual void Present() = 0;
 
     virtual bool IsDxrSupported() const { return false; }
+    // Size of a texture array that shaders may index with a per-draw index, 0 when texture arrays are not supported
+    virtual uint32_t GetMaxBindlessTextures() const { return 0; }
 
     virtual void OnDestroy() {}
 
     void OnResize(int width, int height);
     size_t GetFrameIndex() const;
     GLFWwindow* GetWindow();
+    bool IsHeadless() const;
+    const GpuProfiler& GetGpuProfiler() const;
+
+    struct AttachStats
+    {
+        size_t attaches = 0;
+        // Attaches of the resource and view that were already bound, programs skip their work
+        size_t skipped_attaches = 0;
+    };
+    // Counts of the last presented frame
+    const AttachStats& GetAttachStats() const;
+    void CountAttach(bool skipped);
+
+    struct MemoryStats
+    {
+        size_t memory_blocks = 0;
+        size_t dedicated_allocations = 0;
+        size_t allocations = 0;
+        uint64_t reserved_bytes = 0;
+        uint64_t used_bytes = 0;
+        size_t descriptor_pools = 0;
+        // Descriptor sets of the last completed frame
+        size_t descriptor_sets = 0;
+        size_t peak_descriptor_sets = 0;
+    };
+    // False when the backend does not track its allocations
+    virtual bool GetMemoryStats(MemoryStats& stats) const { return false; }
 
     static constexpr size_t FrameCount = 3;
   
 protected:
     virtual void ResizeBackBuffer(int width, int height) = 0;
+    // Called by Present, publishes the attach counts of the frame and starts counting the next one
+    void UpdateAttachStats();
+    // Throws std::runtime_error when [offset, offset + size) exceeds the buffer
+    void CheckBufferRange(const Resource::Ptr& ires, uint64_t offset, uint64_t size) const;
     int m_width;
     int m_height;
     GLFWwindow* m_window;
     uint32_t m_frame_index = 0;
+    GpuProfiler m_gpu_profiler;
+    // Parallel recording threads attach concurrently
+    std::atomic<size_t> m_attaches{ 0 };
+    std::atomic<size_t> m_skipped_attaches{ 0 };
+    AttachStats m_attach_stats;
 };
 
 template <typename T>
@@ -7,9 +7,13 @@
 #include "Context/VKContext.h"
 #endif
 #include "Context/GLContext.h"
+#include <stdexcept>
 
-std::unique_ptr<Context> CreateContext(ApiType type, GLFWwindow* window)
+std::unique_ptr<Context> CreateContext(ApiType type, GLFWwindow* window, int width, int height)
 {
+    if (!window && type != ApiType::kVulkan && type != ApiType::kOpenGL)
+        throw std::runtime_error("Headless mode is supported only for Vulkan and OpenGL");
+
     switch (type)
     {
 #ifdef DIRECTX_SUPPORT
@@ -20,10 +24,10 @@ std::unique_ptr<Context> CreateContext(ApiType type, GLFWwindow* window)
 #endif
 #ifdef VULKAN_SUPPORT
     case ApiType::kVulkan:
-        return std::make_unique<VKContext>(window);
+        return std::make_unique<VKContext>(window, width, height);
 #endif
     case ApiType::kOpenGL:
-        return std::make_unique<GLContext>(window);
+        return std::make_unique<GLContext>(window, width, height);
     }
     assert(false);
     return nullptr;
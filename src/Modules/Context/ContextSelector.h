@@ -4,4 +4,5 @@
 #include <Scene/IScene.h>
 #include "Context/Context.h"
 
-std::unique_ptr<Context> CreateContext(ApiType type, GLFWwindow* window);
+// A null window creates a headless context rendering offscreen, supported by Vulkan and OpenGL
+std::unique_ptr<Context> CreateContext(ApiType type, GLFWwindow* window, int width = 0, int height = 0);
@@ -233,6 +233,11 @@ Resource::Ptr DX11Context::CreateBuffer(uint32_t bind_flag, uint32_t buffer_size
         desc.BindFlags |= D3D11_BIND_INDEX_BUFFER;
         desc.MiscFlags &= ~D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
     }
+    if (bind_flag & BindFlag::kIndirect)
+    {
+        desc.MiscFlags |= D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+        desc.MiscFlags &= ~D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    }
 
     ComPtr<ID3D11Buffer> buffer;
     ASSERT_SUCCEEDED(device->CreateBuffer(&desc, nullptr, &buffer));
@@ -304,6 +309,37 @@ void DX11Context::UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubre
     int b = 0;
 }
 
+void DX11Context::UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size)
+{
+    CheckBufferRange(ires, offset, size);
+    auto res = std::static_pointer_cast<DX11Resource>(ires);
+    ComPtr<ID3D11Buffer> buffer;
+    ASSERT_SUCCEEDED(res->resource.As(&buffer));
+    D3D11_BUFFER_DESC desc = {};
+    buffer->GetDesc(&desc);
+    // Constant buffers are only updated as a whole
+    if (desc.BindFlags & D3D11_BIND_CONSTANT_BUFFER)
+    {
+        if (offset != 0 || size != desc.ByteWidth)
+            throw std::runtime_error("Constant buffers are updated as a whole");
+        device_context->UpdateSubresource(res->resource.Get(), 0, nullptr, pSrcData, 0, 0);
+        return;
+    }
+    D3D11_BOX box = { static_cast<UINT>(offset), 0, 0, static_cast<UINT>(offset + size), 1, 1 };
+    device_context->UpdateSubresource(res->resource.Get(), 0, &box, pSrcData, 0, 0);
+}
+
+uint64_t DX11Context::GetBufferSize(const Resource::Ptr& ires) const
+{
+    auto res = std::static_pointer_cast<DX11Resource>(ires);
+    ComPtr<ID3D11Buffer> buffer;
+    if (FAILED(res->resource.As(&buffer)))
+        return 0;
+    D3D11_BUFFER_DESC desc = {};
+    buffer->GetDesc(&desc);
+    return desc.ByteWidth;
+}
+
 void DX11Context::SetViewport(float width, float height)
 {
     D3D11_VIEWPORT viewport = {};
@@ -344,6 +380,7 @@ void DX11Context::IASetVertexBuffer(uint32_t slot, Resource::Ptr ires)
 void DX11Context::UseProgram(ProgramApi& program)
 {
     auto& program_api = static_cast<DX11ProgramApi&>(program);
+    program_api.FinishCompilation();
     m_current_program = &program_api;
     m_current_program->UseProgram();
 }
@@ -359,10 +396,23 @@ void DX11Context::EndEvent()
     perf->EndEvent();
 }
 
-void DX11Context::DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation)
+void DX11Context::DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
 {
     m_current_program->ApplyBindings();
-    device_context->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
+    device_context->DrawIndexedInstanced(IndexCount, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void DX11Context::DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count)
+{
+    if (!args || draw_count == 0)
+        return;
+    m_current_program->ApplyBindings();
+    auto res = std::static_pointer_cast<DX11Resource>(args);
+    ComPtr<ID3D11Buffer> buffer;
+    res->resource.As(&buffer);
+    // D3D11 has no multi-draw, every command is a separate indirect draw
+    for (uint32_t i = 0; i < draw_count; ++i)
+        device_context->DrawIndexedInstancedIndirect(buffer.Get(), offset + i * sizeof(DrawIndexedIndirectCommand));
 }
 
 void DX11Context::Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ)
@@ -384,6 +434,7 @@ Resource::Ptr DX11Context::GetBackBuffer()
 
 void DX11Context::Present()
 {
+    UpdateAttachStats();
     if (CurState::Instance().vsync)
     {
         ASSERT_SUCCEEDED(m_swap_chain->Present(1, 0));
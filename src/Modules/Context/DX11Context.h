@@ -21,6 +21,8 @@ public:
     virtual Resource::Ptr CreateBuffer(uint32_t bind_flag, uint32_t buffer_size, uint32_t stride) override;
     virtual Resource::Ptr CreateSampler(const SamplerDesc& desc) override;
     virtual void UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubresource, const void *pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch) override;
+    virtual void UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size) override;
+    virtual uint64_t GetBufferSize(const Resource::Ptr& ires) const override;
 
     virtual void SetViewport(float width, float height) override;
     virtual void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom) override;
@@ -33,7 +35,8 @@ public:
     virtual void BeginEvent(const std::string& name) override;
     virtual void EndEvent() override;
 
-    virtual void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation) override;
+    virtual void DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+    virtual void DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count) override;
     virtual void Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ) override;
 
     virtual Resource::Ptr GetBackBuffer() override;
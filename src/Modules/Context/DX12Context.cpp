@@ -456,6 +456,51 @@ void DX12Context::UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubre
     ResourceBarrier(res, D3D12_RESOURCE_STATE_COMMON);
 }
 
+void DX12Context::UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size)
+{
+    CheckBufferRange(ires, offset, size);
+    auto res = std::static_pointer_cast<DX12Resource>(ires);
+    CD3DX12_RANGE read_range(0, 0);
+    CD3DX12_RANGE written_range(offset, offset + size);
+
+    if (res->bind_flag & BindFlag::kCbv)
+    {
+        char* cbvGPUAddress = nullptr;
+        ASSERT_SUCCEEDED(res->default_res->Map(0, &read_range, reinterpret_cast<void**>(&cbvGPUAddress)));
+        memcpy(cbvGPUAddress + offset, pSrcData, size);
+        res->default_res->Unmap(0, &written_range);
+        return;
+    }
+
+    // The upload resource mirrors the whole buffer, only the updated range is copied
+    auto& upload_res = res->GetUploadResource(0);
+    if (!upload_res)
+    {
+        device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(res->buffer_size),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&upload_res));
+    }
+    char* upload_data = nullptr;
+    ASSERT_SUCCEEDED(upload_res->Map(0, &read_range, reinterpret_cast<void**>(&upload_data)));
+    memcpy(upload_data + offset, pSrcData, size);
+    upload_res->Unmap(0, &written_range);
+
+    CloseRenderPass();
+
+    ResourceBarrier(res, D3D12_RESOURCE_STATE_COPY_DEST);
+    command_list->CopyBufferRegion(res->default_res.Get(), offset, upload_res.Get(), offset, size);
+    ResourceBarrier(res, D3D12_RESOURCE_STATE_COMMON);
+}
+
+uint64_t DX12Context::GetBufferSize(const Resource::Ptr& ires) const
+{
+    return std::static_pointer_cast<DX12Resource>(ires)->buffer_size;
+}
+
 void DX12Context::SetViewport(float width, float height)
 {
     D3D12_VIEWPORT viewport;
@@ -502,6 +547,7 @@ void DX12Context::IASetVertexBuffer(uint32_t slot, Resource::Ptr ires)
 void DX12Context::UseProgram(ProgramApi& program)
 {
     auto& program_api = static_cast<DX12ProgramApi&>(program);
+    program_api.FinishCompilation();
     if (m_current_program != &program_api && m_use_render_passes)
         CloseRenderPass();
     m_current_program = &program_api;
@@ -519,10 +565,32 @@ void DX12Context::EndEvent()
     PIXEndEvent(command_list.Get());
 }
 
-void DX12Context::DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation)
+void DX12Context::DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
 {
     m_current_program->ApplyBindings();
-    command_list->DrawIndexedInstanced(IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0);
+    command_list->DrawIndexedInstanced(IndexCount, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void DX12Context::DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count)
+{
+    if (!args || draw_count == 0)
+        return;
+
+    if (!m_draw_indexed_signature)
+    {
+        D3D12_INDIRECT_ARGUMENT_DESC argument_desc = {};
+        argument_desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+        D3D12_COMMAND_SIGNATURE_DESC signature_desc = {};
+        signature_desc.ByteStride = sizeof(DrawIndexedIndirectCommand);
+        signature_desc.NumArgumentDescs = 1;
+        signature_desc.pArgumentDescs = &argument_desc;
+        ASSERT_SUCCEEDED(device->CreateCommandSignature(&signature_desc, nullptr, IID_PPV_ARGS(&m_draw_indexed_signature)));
+    }
+
+    auto res = std::static_pointer_cast<DX12Resource>(args);
+    ResourceBarrier(res, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    m_current_program->ApplyBindings();
+    command_list->ExecuteIndirect(m_draw_indexed_signature.Get(), draw_count, res->default_res.Get(), offset, nullptr, 0);
 }
 
 void DX12Context::Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ)
@@ -552,6 +620,7 @@ Resource::Ptr DX12Context::GetBackBuffer()
 
 void DX12Context::Present()
 {
+    UpdateAttachStats();
     CloseRenderPass();
 
     ResourceBarrier(std::static_pointer_cast<DX12Resource>(GetBackBuffer()), D3D12_RESOURCE_STATE_PRESENT);
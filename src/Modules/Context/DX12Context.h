@@ -27,6 +27,8 @@ public:
     virtual Resource::Ptr CreateBottomLevelAS(const BufferDesc& vertex, const BufferDesc& index) override;
     virtual Resource::Ptr CreateTopLevelAS(const std::vector<std::pair<Resource::Ptr, glm::mat4>>& geometry) override;
     virtual void UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubresource, const void *pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch) override;
+    virtual void UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size) override;
+    virtual uint64_t GetBufferSize(const Resource::Ptr& ires) const override;
 
     virtual void SetViewport(float width, float height) override;
     virtual void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom) override;
@@ -39,7 +41,8 @@ public:
     virtual void BeginEvent(const std::string& name) override;
     virtual void EndEvent() override;
 
-    virtual void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation) override;
+    virtual void DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+    virtual void DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count) override;
     virtual void Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ) override;
     virtual void DispatchRays(uint32_t width, uint32_t height, uint32_t depth) override;
 
@@ -86,4 +89,5 @@ private:
     std::vector<std::reference_wrapper<DX12ProgramApi>> m_created_program;
     Resource::Ptr m_back_buffers[FrameCount];
     bool m_is_dxr_supported = false;
+    ComPtr<ID3D12CommandSignature> m_draw_indexed_signature;
 };
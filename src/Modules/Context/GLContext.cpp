@@ -4,8 +4,19 @@
 #include <glm/glm.hpp>
 #include <gli/gli.hpp>
 #include <iostream>
+#include <cstring>
 #include <Program/GLProgramApi.h>
 #include <Resource/GLResource.h>
+#include <stdexcept>
+#if defined(__linux__)
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
 
 static void APIENTRY gl_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *msg, const void *data)
 {
@@ -18,10 +29,13 @@ static void APIENTRY gl_callback(GLenum source, GLenum type, GLuint id, GLenum s
     std::cout << "debug call: " << msg << std::endl;
 }
 
-GLContext::GLContext(GLFWwindow* window)
-    : Context(window)
+GLContext::GLContext(GLFWwindow* window, int width, int height)
+    : Context(window, width, height)
 {
-    gladLoadGL();
+    if (m_window)
+        gladLoadGL();
+    else
+        CreateHeadlessContext();
 
     if (glDebugMessageCallback)
     {
@@ -47,6 +61,102 @@ GLContext::GLContext(GLFWwindow* window)
 
     glEnable(GL_DEPTH_TEST);
     glDepthRange(0, 1);
+
+    GLint cbv_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &cbv_alignment);
+    m_constant_ring.reset(new ConstantRing(*this, FrameCount, cbv_alignment));
+}
+
+GLContext::~GLContext()
+{
+    for (auto& queries : m_timestamp_queries)
+    {
+        if (!queries.empty())
+            glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    }
+
+    for (GLsync& fence : m_frame_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    m_constant_ring.reset();
+
+    if (!m_egl_display)
+        return;
+
+    m_final_texture.reset();
+    glDeleteFramebuffers(1, &m_final_framebuffer);
+
+#if defined(__linux__)
+    eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_egl_surface)
+        eglDestroySurface(m_egl_display, m_egl_surface);
+    eglDestroyContext(m_egl_display, m_egl_context);
+    eglTerminate(m_egl_display);
+#endif
+}
+
+void GLContext::CreateHeadlessContext()
+{
+#if defined(__linux__)
+    // The surfaceless platform needs neither a display server nor a drawable
+    auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        throw std::runtime_error("eglInitialize failed");
+    m_egl_display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw std::runtime_error("eglBindAPI failed");
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) || config_count == 0)
+        throw std::runtime_error("eglChooseConfig failed");
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    m_egl_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (m_egl_context == EGL_NO_CONTEXT)
+        throw std::runtime_error("eglCreateContext failed");
+
+    // Rendering goes to framebuffer objects only, a 1x1 pbuffer stands in for drivers without surfaceless contexts
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbuffer_attribs[] = {
+            EGL_WIDTH, 1,
+            EGL_HEIGHT, 1,
+            EGL_NONE
+        };
+        m_egl_surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+        if (m_egl_surface == EGL_NO_SURFACE)
+            throw std::runtime_error("eglCreatePbufferSurface failed");
+    }
+
+    EGLSurface surface = m_egl_surface ? m_egl_surface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(display, surface, surface, m_egl_context))
+        throw std::runtime_error("eglMakeCurrent failed");
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+        throw std::runtime_error("gladLoadGLLoader failed");
+#else
+    throw std::runtime_error("Headless OpenGL is supported only on Linux");
+#endif
 }
 
 std::unique_ptr<ProgramApi> GLContext::CreateProgram()
@@ -92,9 +202,13 @@ Resource::Ptr GLContext::CreateBuffer(uint32_t bind_flag, uint32_t buffer_size,
 {
     GLResource::Ptr res = std::make_shared<GLResource>();
 
+    GLbitfield flags = GL_DYNAMIC_STORAGE_BIT;
+    if (bind_flag & (BindFlag::kCpuWrite | BindFlag::kCbv))
+        flags |= GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT;
+
     glCreateBuffers(1, &res->buffer);
     if (buffer_size)
-        glNamedBufferStorage(res->buffer, buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(res->buffer, buffer_size, nullptr, flags);
     res->res_type = GLResource::Type::kBuffer;
     res->buffer_size = buffer_size;
     res->buffer_stride = stride;
@@ -130,6 +244,48 @@ void GLContext::UpdateSubresource(const Resource::Ptr & ires, uint32_t DstSubres
     }
 }
 
+void GLContext::UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size)
+{
+    GLResource& res = static_cast<GLResource&>(*ires);
+    CheckBufferRange(ires, offset, size);
+    if (res.buffer_mapped)
+    {
+        memcpy(res.buffer_mapped + offset, pSrcData, size);
+        FlushBuffer(ires, offset, size);
+    }
+    else
+    {
+        glNamedBufferSubData(res.buffer, offset, size, pSrcData);
+    }
+}
+
+uint64_t GLContext::GetBufferSize(const Resource::Ptr& ires) const
+{
+    return static_cast<GLResource&>(*ires).buffer_size;
+}
+
+uint8_t* GLContext::MapBuffer(const Resource::Ptr& ires)
+{
+    GLResource& res = static_cast<GLResource&>(*ires);
+    if (!res.buffer_mapped)
+    {
+        GLint flags = 0;
+        glGetNamedBufferParameteriv(res.buffer, GL_BUFFER_STORAGE_FLAGS, &flags);
+        if (!(flags & GL_MAP_PERSISTENT_BIT))
+            return nullptr;
+        res.buffer_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(res.buffer, 0, res.buffer_size,
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+    }
+    return res.buffer_mapped;
+}
+
+void GLContext::FlushBuffer(const Resource::Ptr& ires, uint64_t offset, uint64_t size)
+{
+    GLResource& res = static_cast<GLResource&>(*ires);
+    if (res.buffer_mapped)
+        glFlushMappedNamedBufferRange(res.buffer, offset, size);
+}
+
 void GLContext::SetViewport(float width, float height)
 {
     glViewport(0, 0, width, height);
@@ -159,6 +315,7 @@ void GLContext::IASetVertexBuffer(uint32_t slot, Resource::Ptr ires)
 void GLContext::UseProgram(ProgramApi& program)
 {
     auto& program_api = static_cast<GLProgramApi&>(program);
+    program_api.FinishCompilation();
     m_current_program = &program_api;
     m_current_program->UseProgram();
 }
@@ -166,17 +323,80 @@ void GLContext::UseProgram(ProgramApi& program)
 void GLContext::BeginEvent(const std::string& name)
 {
     glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+    WriteTimestamp(m_gpu_profiler.BeginEvent(m_timestamp_frame, name));
 }
 
 void GLContext::EndEvent()
 {
+    WriteTimestamp(m_gpu_profiler.EndEvent(m_timestamp_frame));
     glPopDebugGroup();
 }
 
-void GLContext::DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation)
+void GLContext::WriteTimestamp(uint32_t query)
+{
+    if (query == GpuProfiler::kInvalidQuery)
+        return;
+    auto& queries = m_timestamp_queries[m_timestamp_frame];
+    if (query >= queries.size())
+    {
+        size_t old_size = queries.size();
+        queries.resize(query + 1);
+        glGenQueries(static_cast<GLsizei>(queries.size() - old_size), queries.data() + old_size);
+    }
+    glQueryCounter(queries[query], GL_TIMESTAMP);
+    auto& issued = m_timestamp_issued[m_timestamp_frame];
+    if (query >= issued.size())
+        issued.resize(query + 1);
+    issued[query] = true;
+}
+
+void GLContext::ResolveTimestamps()
 {
+    uint32_t query_count = m_gpu_profiler.GetQueryCount(m_timestamp_frame);
+    const auto& queries = m_timestamp_queries[m_timestamp_frame];
+    auto& issued = m_timestamp_issued[m_timestamp_frame];
+    auto is_issued = [&](uint32_t i) { return i < queries.size() && i < issued.size() && issued[i]; };
+
+    // Results that are still in flight are dropped instead of waited for,
+    // queries never written are skipped, the profiler ignores the events they belong to
+    bool available = query_count > 0;
+    for (uint32_t i = 0; i < query_count && available; ++i)
+    {
+        if (!is_issued(i))
+            continue;
+        GLuint result_available = GL_FALSE;
+        glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &result_available);
+        available = result_available == GL_TRUE;
+    }
+
+    if (available)
+    {
+        std::vector<uint64_t> timestamps(query_count);
+        for (uint32_t i = 0; i < query_count; ++i)
+        {
+            if (is_issued(i))
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &timestamps[i]);
+        }
+        m_gpu_profiler.Resolve(m_timestamp_frame, timestamps.data(), 1.0);
+    }
+    issued.assign(issued.size(), false);
+    m_gpu_profiler.OnFrameBegin(m_timestamp_frame);
+}
+
+void GLContext::DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
+{
+    m_current_program->ApplyBindings();
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, IndexCount, m_ibo_type, (void*)(m_ibo_size * StartIndexLocation), InstanceCount, BaseVertexLocation, StartInstanceLocation);
+}
+
+void GLContext::DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count)
+{
+    if (!args || draw_count == 0)
+        return;
     m_current_program->ApplyBindings();
-    glDrawElementsBaseVertex(GL_TRIANGLES, IndexCount, m_ibo_type, (void*)(m_ibo_size * StartIndexLocation), BaseVertexLocation);
+    GLResource& res = static_cast<GLResource&>(*args);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, res.buffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, m_ibo_type, (void*)(size_t)offset, draw_count, sizeof(DrawIndexedIndirectCommand));
 }
 
 void GLContext::Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ)
@@ -192,10 +412,35 @@ Resource::Ptr GLContext::GetBackBuffer()
 
 void GLContext::Present()
 {
-    glBlitNamedFramebuffer(m_final_framebuffer, 0, 0, 0, m_width, m_height, 0, m_height, m_width, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-    glfwSwapBuffers(m_window);
+    UpdateAttachStats();
+    if (m_window)
+    {
+        glBlitNamedFramebuffer(m_final_framebuffer, 0, 0, 0, m_width, m_height, 0, m_height, m_width, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glfwSwapBuffers(m_window);
+    }
+
+    // At most FrameCount frames are kept in flight, so the constant ring slot of the next frame is free to overwrite
+    m_frame_fences[m_frame_fence_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_frame_fence_index = (m_frame_fence_index + 1) % FrameCount;
+    GLsync& fence = m_frame_fences[m_frame_fence_index];
+    if (fence)
+    {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_constant_ring->OnFrameBegin(m_frame_fence_index);
+
+    // Timestamps of a slot are read back FrameCount frames after they were written
+    m_timestamp_frame = (m_timestamp_frame + 1) % FrameCount;
+    ResolveTimestamps();
 }
 
 void GLContext::ResizeBackBuffer(int width, int height)
 {
 }
+
+ConstantRing& GLContext::GetConstantRing()
+{
+    return *m_constant_ring;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Context/Context.h"
+#include "Context/ConstantRing.h"
 #include <GLFW/glfw3.h>
 #include <Geometry/IABuffer.h>
 #include <assimp/postprocess.h>
@@ -10,13 +11,18 @@ class GLProgramApi;
 class GLContext : public Context
 {
 public:
-    GLContext(GLFWwindow* window);
+    GLContext(GLFWwindow* window, int width = 0, int height = 0);
+    ~GLContext();
 
     virtual std::unique_ptr<ProgramApi> CreateProgram() override;
     virtual Resource::Ptr CreateTexture(uint32_t bind_flag, gli::format format, uint32_t msaa_count, int width, int height, int depth = 1, int mip_levels = 1) override;
     virtual Resource::Ptr CreateBuffer(uint32_t bind_flag, uint32_t buffer_size, uint32_t stride) override;
     virtual Resource::Ptr CreateSampler(const SamplerDesc& desc) override;
     virtual void UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubresource, const void *pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch) override;
+    virtual void UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size) override;
+    virtual uint8_t* MapBuffer(const Resource::Ptr& ires) override;
+    virtual uint64_t GetBufferSize(const Resource::Ptr& ires) const override;
+    virtual void FlushBuffer(const Resource::Ptr& ires, uint64_t offset, uint64_t size) override;
 
     virtual void SetViewport(float width, float height) override;
     virtual void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom) override;
@@ -29,7 +35,8 @@ public:
     virtual void BeginEvent(const std::string& name) override;
     virtual void EndEvent() override;
 
-    virtual void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation) override;
+    virtual void DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+    virtual void DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count) override;
     virtual void Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ) override;
 
     virtual Resource::Ptr GetBackBuffer() override;
@@ -37,9 +44,29 @@ public:
 
     virtual void ResizeBackBuffer(int width, int height) override;
 
+    ConstantRing& GetConstantRing();
+
     GLProgramApi* m_current_program = nullptr;
     Resource::Ptr m_final_texture;
     GLuint m_final_framebuffer = 0;
     GLenum m_ibo_type = GL_NONE;
     uint32_t m_ibo_size = 0;
+
+private:
+    void CreateHeadlessContext();
+    void WriteTimestamp(uint32_t query);
+    void ResolveTimestamps();
+
+    // EGLDisplay, EGLSurface and EGLContext of the headless mode
+    void* m_egl_display = nullptr;
+    void* m_egl_surface = nullptr;
+    void* m_egl_context = nullptr;
+    std::array<GLsync, FrameCount> m_frame_fences = {};
+    size_t m_frame_fence_index = 0;
+    std::unique_ptr<ConstantRing> m_constant_ring;
+
+    std::vector<GLuint> m_timestamp_queries[FrameCount];
+    // Queries written this frame, the end query of an event left open is allocated by the profiler but never written
+    std::vector<bool> m_timestamp_issued[FrameCount];
+    size_t m_timestamp_frame = 0;
 };
@@ -0,0 +1,173 @@
+#include "Context/GpuProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+GpuProfiler::Node& GpuProfiler::Node::GetChild(const std::string& child_name)
+{
+    for (auto& child : children)
+    {
+        if (child->name == child_name)
+            return *child;
+    }
+    children.emplace_back(new Node);
+    children.back()->name = child_name;
+    return *children.back();
+}
+
+void GpuProfiler::Node::AddSample(double ms)
+{
+    if (m_history.size() < kHistorySize)
+        m_history.push_back(ms);
+    else
+        m_history[m_history_pos] = ms;
+    m_history_pos = (m_history_pos + 1) % kHistorySize;
+
+    last_ms = ms;
+    min_ms = *std::min_element(m_history.begin(), m_history.end());
+    max_ms = *std::max_element(m_history.begin(), m_history.end());
+    avg_ms = 0;
+    for (double sample : m_history)
+        avg_ms += sample;
+    avg_ms /= m_history.size();
+}
+
+GpuProfiler::GpuProfiler(size_t frame_count)
+    : m_frames(frame_count)
+{
+    m_root.name = "Frame";
+}
+
+void GpuProfiler::OnFrameBegin(size_t frame)
+{
+    Frame& cur = m_frames[frame];
+    cur.events.clear();
+    cur.open_events.clear();
+    cur.query_count = 0;
+}
+
+uint32_t GpuProfiler::BeginEvent(size_t frame, const std::string& name)
+{
+    Frame& cur = m_frames[frame];
+    size_t parent = cur.open_events.empty() ? kNoParent : cur.open_events.back();
+
+    // Events past the query budget keep the nesting but are not timed
+    uint32_t begin_query = kInvalidQuery;
+    uint32_t end_query = kInvalidQuery;
+    if (cur.query_count + 2 <= kMaxQueries)
+    {
+        begin_query = cur.query_count++;
+        end_query = cur.query_count++;
+    }
+
+    cur.open_events.push_back(cur.events.size());
+    cur.events.push_back({ name, parent, begin_query, end_query, false });
+    return begin_query;
+}
+
+uint32_t GpuProfiler::EndEvent(size_t frame)
+{
+    Frame& cur = m_frames[frame];
+    if (cur.open_events.empty())
+        return kInvalidQuery;
+    Event& event = cur.events[cur.open_events.back()];
+    cur.open_events.pop_back();
+    event.closed = true;
+    return event.end_query;
+}
+
+uint32_t GpuProfiler::GetQueryCount(size_t frame) const
+{
+    return m_frames[frame].query_count;
+}
+
+void GpuProfiler::Resolve(size_t frame, const uint64_t* timestamps, double tick_ns)
+{
+    const Frame& cur = m_frames[frame];
+    if (cur.events.empty())
+        return;
+
+    // Events recorded several times under the same parent add up to one sample per frame
+    std::vector<Node*> nodes(cur.events.size());
+    double frame_ms = 0;
+    for (size_t i = 0; i < cur.events.size(); ++i)
+    {
+        const Event& event = cur.events[i];
+        Node& parent = event.parent == kNoParent ? m_root : *nodes[event.parent];
+        Node& node = parent.GetChild(event.name);
+        nodes[i] = &node;
+
+        if (!event.closed || event.begin_query == kInvalidQuery)
+            continue;
+        uint64_t begin = timestamps[event.begin_query];
+        uint64_t end = timestamps[event.end_query];
+        if (end < begin)
+            continue;
+
+        double ms = (end - begin) * tick_ns * 1e-6;
+        node.m_frame_ms += ms;
+        node.m_touched = true;
+        if (event.parent == kNoParent)
+            frame_ms += ms;
+    }
+
+    for (Node* node : nodes)
+    {
+        if (!node->m_touched)
+            continue;
+        node->AddSample(node->m_frame_ms);
+        node->m_frame_ms = 0;
+        node->m_touched = false;
+    }
+    m_root.AddSample(frame_ms);
+}
+
+const GpuProfiler::Node& GpuProfiler::GetRoot() const
+{
+    return m_root;
+}
+
+void GpuProfiler::DumpJson(std::ostream& os) const
+{
+    DumpJson(os, m_root, 0);
+    os << std::endl;
+}
+
+bool GpuProfiler::DumpJson(const std::string& path) const
+{
+    std::ofstream os(path);
+    if (!os)
+        return false;
+    DumpJson(os);
+    return static_cast<bool>(os);
+}
+
+void GpuProfiler::DumpJson(std::ostream& os, const Node& node, size_t indent) const
+{
+    std::string pad(indent, ' ');
+    std::string name;
+    for (char c : node.name)
+    {
+        if (c == '"' || c == '\\')
+            name += '\\';
+        name += c;
+    }
+
+    os << pad << "{" << std::endl;
+    os << pad << "  \"name\": \"" << name << "\"," << std::endl;
+    os << std::fixed << std::setprecision(4);
+    os << pad << "  \"last_ms\": " << node.last_ms << "," << std::endl;
+    os << pad << "  \"min_ms\": " << node.min_ms << "," << std::endl;
+    os << pad << "  \"avg_ms\": " << node.avg_ms << "," << std::endl;
+    os << pad << "  \"max_ms\": " << node.max_ms << "," << std::endl;
+    os << pad << "  \"children\": [";
+    for (size_t i = 0; i < node.children.size(); ++i)
+    {
+        os << (i ? "," : "") << std::endl;
+        DumpJson(os, *node.children[i], indent + 4);
+    }
+    if (!node.children.empty())
+        os << std::endl << pad << "  ";
+    os << "]" << std::endl;
+    os << pad << "}";
+}
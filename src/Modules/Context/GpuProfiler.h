@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Turns the timestamps written around BeginEvent/EndEvent into a tree of per-pass GPU timings.
+// Every frame slot owns kMaxQueries queries of the backend, an event takes one query on each side.
+// Results of a slot are resolved when the slot is reused, so reading them never stalls.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t kMaxEvents = 256;
+    static constexpr uint32_t kMaxQueries = 2 * kMaxEvents;
+    static constexpr uint32_t kInvalidQuery = ~0u;
+    static constexpr size_t kHistorySize = 128;
+
+    struct Node
+    {
+        std::string name;
+        // Rolling statistics over the last kHistorySize frames in which the event was recorded
+        double last_ms = 0;
+        double min_ms = 0;
+        double avg_ms = 0;
+        double max_ms = 0;
+        std::vector<std::unique_ptr<Node>> children;
+
+    private:
+        friend class GpuProfiler;
+        Node& GetChild(const std::string& child_name);
+        void AddSample(double ms);
+
+        std::vector<double> m_history;
+        size_t m_history_pos = 0;
+        double m_frame_ms = 0;
+        bool m_touched = false;
+    };
+
+    GpuProfiler(size_t frame_count);
+
+    // Called once the previous results of the slot are resolved, before new events are recorded
+    void OnFrameBegin(size_t frame);
+    // Return the query to write the timestamp into, kInvalidQuery when the slot is full
+    uint32_t BeginEvent(size_t frame, const std::string& name);
+    uint32_t EndEvent(size_t frame);
+    uint32_t GetQueryCount(size_t frame) const;
+
+    // timestamps[i] holds query i of the slot in ticks of tick_ns nanoseconds
+    void Resolve(size_t frame, const uint64_t* timestamps, double tick_ns);
+
+    const Node& GetRoot() const;
+    void DumpJson(std::ostream& os) const;
+    bool DumpJson(const std::string& path) const;
+
+private:
+    struct Event
+    {
+        std::string name;
+        size_t parent;
+        uint32_t begin_query;
+        uint32_t end_query;
+        bool closed;
+    };
+
+    struct Frame
+    {
+        std::vector<Event> events;
+        std::vector<size_t> open_events;
+        uint32_t query_count = 0;
+    };
+
+    static constexpr size_t kNoParent = ~size_t(0);
+
+    void DumpJson(std::ostream& os, const Node& node, size_t indent) const;
+
+    std::vector<Frame> m_frames;
+    Node m_root;
+};
@@ -16,6 +16,7 @@
 #include <gli/gli.hpp>
 #include <Utilities/VKUtility.h>
 #include <Utilities/State.h>
+#include <Utilities/ScopeGuard.h>
 
 class DebugReportListener
 {
@@ -163,6 +164,15 @@ void VKContext::SelectPhysicalDevice()
             break;
         }
     }
+
+    // Software implementations report a CPU device, they are taken only when there is no GPU
+    if (m_physical_device == VK_NULL_HANDLE && !devices.empty())
+    {
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(devices.front(), &device_properties);
+        m_physical_device = devices.front();
+        CurState::Instance().gpu_name = device_properties.deviceName;
+    }
 }
 
 void VKContext::SelectQueueFamilyIndex()
@@ -183,16 +193,37 @@ void VKContext::SelectQueueFamilyIndex()
         }
     }
     ASSERT(m_queue_family_index != -1);
+    m_timestamp_valid_bits = queue_families[m_queue_family_index].timestampValidBits;
+
+    // A compute-only family maps to the asynchronous compute engine, without one
+    // compute sections are recorded inline on the graphics queue
+    m_compute_queue_family_index = m_queue_family_index;
+    for (size_t i = 0; i < queue_families.size(); ++i)
+    {
+        const auto& queue = queue_families[i];
+        if (queue.queueCount > 0 && queue.queueFlags & VK_QUEUE_COMPUTE_BIT && !(queue.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            m_compute_queue_family_index = static_cast<uint32_t>(i);
+            break;
+        }
+    }
+    m_queue_family_indices = { m_queue_family_index, m_compute_queue_family_index };
 }
 
 void VKContext::CreateDevice()
 {
     const float queue_priority = 1.0f;
-    VkDeviceQueueCreateInfo queue_create_info = {};
+    std::vector<VkDeviceQueueCreateInfo> queue_create_infos(1);
+    VkDeviceQueueCreateInfo& queue_create_info = queue_create_infos.front();
     queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queue_create_info.queueFamilyIndex = m_queue_family_index;
     queue_create_info.queueCount = 1;
     queue_create_info.pQueuePriorities = &queue_priority;
+    if (IsAsyncComputeSupported())
+    {
+        queue_create_infos.push_back(queue_create_info);
+        queue_create_infos.back().queueFamilyIndex = m_compute_queue_family_index;
+    }
 
     VkPhysicalDeviceFeatures device_features = {};
     device_features.textureCompressionBC = true;
@@ -203,13 +234,31 @@ void VKContext::CreateDevice()
     device_features.geometryShader = true;
     device_features.imageCubeArray = true;
 
+    // Texture arrays indexed with a dynamically uniform index, used for bindless materials
+    VkPhysicalDeviceFeatures supported_features = {};
+    vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+    if (supported_features.shaderSampledImageArrayDynamicIndexing)
+    {
+        device_features.shaderSampledImageArrayDynamicIndexing = true;
+        VkPhysicalDeviceProperties device_properties = {};
+        vkGetPhysicalDeviceProperties(m_physical_device, &device_properties);
+        m_max_bindless_textures = std::min(device_properties.limits.maxPerStageDescriptorSampledImages, device_properties.limits.maxDescriptorSetSampledImages);
+    }
+    // Without it DrawIndexedIndirect records one indirect draw per command
+    if (supported_features.multiDrawIndirect)
+    {
+        device_features.multiDrawIndirect = true;
+        m_is_multi_draw_indirect_supported = true;
+    }
+
     uint32_t extension_count = 0;
     ASSERT_SUCCEEDED(vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, nullptr));
     std::vector<VkExtensionProperties> extensions(extension_count);
     ASSERT_SUCCEEDED(vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, extensions.data()));
     std::set<std::string> req_extension = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-        VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME
+        VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME,
+        VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME
     };
     std::vector<const char*> found_extension;
     for (const auto& extension : extensions)
@@ -220,13 +269,19 @@ void VKContext::CreateDevice()
 
     VkDeviceCreateInfo device_create_info = {};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_create_info.queueCreateInfoCount = 1;
-    device_create_info.pQueueCreateInfos = &queue_create_info;
+    device_create_info.queueCreateInfoCount = queue_create_infos.size();
+    device_create_info.pQueueCreateInfos = queue_create_infos.data();
     device_create_info.pEnabledFeatures = &device_features;
     device_create_info.enabledExtensionCount = found_extension.size();
     device_create_info.ppEnabledExtensionNames = found_extension.data();
 
     ASSERT_SUCCEEDED(vkCreateDevice(m_physical_device, &device_create_info, nullptr, &m_device));
+
+    m_vkCreateDescriptorUpdateTemplateKHR = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplateKHR>(vkGetDeviceProcAddr(m_device, "vkCreateDescriptorUpdateTemplateKHR"));
+    m_vkDestroyDescriptorUpdateTemplateKHR = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplateKHR>(vkGetDeviceProcAddr(m_device, "vkDestroyDescriptorUpdateTemplateKHR"));
+    m_vkUpdateDescriptorSetWithTemplateKHR = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplateKHR>(vkGetDeviceProcAddr(m_device, "vkUpdateDescriptorSetWithTemplateKHR"));
+    if (!m_vkCreateDescriptorUpdateTemplateKHR || !m_vkDestroyDescriptorUpdateTemplateKHR || !m_vkUpdateDescriptorSetWithTemplateKHR)
+        throw std::runtime_error("VK_KHR_descriptor_update_template is not supported");
 }
 
 void VKContext::CreateSwapchain(int width, int height)
@@ -255,7 +310,9 @@ void VKContext::CreateSwapchain(int width, int height)
     VkSwapchainCreateInfoKHR swap_chain_create_info = {};
     swap_chain_create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     swap_chain_create_info.surface = m_surface;
-    swap_chain_create_info.minImageCount = FrameCount;
+    swap_chain_create_info.minImageCount = std::max(m_frames_in_flight, surface_capabilities.minImageCount);
+    if (surface_capabilities.maxImageCount)
+        swap_chain_create_info.minImageCount = std::min(swap_chain_create_info.minImageCount, surface_capabilities.maxImageCount);
     swap_chain_create_info.imageFormat = m_swapchain_color_format;
     swap_chain_create_info.imageColorSpace = color_space;
     swap_chain_create_info.imageExtent = surface_capabilities.currentExtent;
@@ -273,63 +330,112 @@ void VKContext::CreateSwapchain(int width, int height)
     ASSERT_SUCCEEDED(vkCreateSwapchainKHR(m_device, &swap_chain_create_info, nullptr, &m_swapchain));
 }
 
-VKContext::VKContext(GLFWwindow* window)
-    : Context(window)
+VKContext::VKContext(GLFWwindow* window, int width, int height)
+    : Context(window, width, height)
+    , m_frames_in_flight(std::max<uint32_t>(1, std::min<uint32_t>(CurState::Instance().frames_in_flight, FrameCount)))
 {
     CreateInstance();
     SelectPhysicalDevice();
     SelectQueueFamilyIndex();
     CreateDevice();
     vkGetDeviceQueue(m_device, m_queue_family_index, 0, &m_queue);
-    ASSERT_SUCCEEDED(glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface));
-    CreateSwapchain(m_width, m_height);
+    vkGetDeviceQueue(m_device, m_compute_queue_family_index, 0, &m_compute_queue);
+    memory_allocator.reset(new VKMemoryAllocator(*this));
+    if (m_window)
+    {
+        ASSERT_SUCCEEDED(glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface));
+        CreateSwapchain(m_width, m_height);
 
-    uint32_t frame_buffer_count = 0;
-    ASSERT_SUCCEEDED(vkGetSwapchainImagesKHR(m_device, m_swapchain, &frame_buffer_count, nullptr));
-    m_images.resize(frame_buffer_count);
-    ASSERT_SUCCEEDED(vkGetSwapchainImagesKHR(m_device, m_swapchain, &frame_buffer_count, m_images.data()));
+        uint32_t frame_buffer_count = 0;
+        ASSERT_SUCCEEDED(vkGetSwapchainImagesKHR(m_device, m_swapchain, &frame_buffer_count, nullptr));
+        m_images.resize(frame_buffer_count);
+        ASSERT_SUCCEEDED(vkGetSwapchainImagesKHR(m_device, m_swapchain, &frame_buffer_count, m_images.data()));
+    }
 
     VkCommandPoolCreateInfo cmd_pool_create_info = {};
     cmd_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     cmd_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     cmd_pool_create_info.queueFamilyIndex = m_queue_family_index;
     ASSERT_SUCCEEDED(vkCreateCommandPool(m_device, &cmd_pool_create_info, nullptr, &m_cmd_pool));
+    if (IsAsyncComputeSupported())
+    {
+        cmd_pool_create_info.queueFamilyIndex = m_compute_queue_family_index;
+        ASSERT_SUCCEEDED(vkCreateCommandPool(m_device, &cmd_pool_create_info, nullptr, &m_compute_cmd_pool));
+    }
+
+    // Command pools are externally synchronized, every recording thread gets its own
+    m_thread_pool.reset(new ThreadPool());
+    m_worker_cmd_pools.resize(m_thread_pool->GetWorkerCount());
+    for (auto& worker_cmd_pool : m_worker_cmd_pools)
+    {
+        cmd_pool_create_info.queueFamilyIndex = m_queue_family_index;
+        ASSERT_SUCCEEDED(vkCreateCommandPool(m_device, &cmd_pool_create_info, nullptr, &worker_cmd_pool.pool));
+    }
 
-    m_cmd_bufs.resize(frame_buffer_count);
-    VkCommandBufferAllocateInfo cmd_buf_alloc_info = {};
-    cmd_buf_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmd_buf_alloc_info.commandPool = m_cmd_pool;
-    cmd_buf_alloc_info.commandBufferCount = m_cmd_bufs.size();
-    cmd_buf_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    ASSERT_SUCCEEDED(vkAllocateCommandBuffers(m_device, &cmd_buf_alloc_info, m_cmd_bufs.data()));
+    // Timestamps of BeginEvent/EndEvent, one pool per frame so that results are read only after the frame fence
+    VkPhysicalDeviceProperties device_properties = {};
+    vkGetPhysicalDeviceProperties(m_physical_device, &device_properties);
+    if (m_timestamp_valid_bits && device_properties.limits.timestampPeriod > 0)
+    {
+        m_timestamp_period = device_properties.limits.timestampPeriod;
+        VkQueryPoolCreateInfo query_pool_create_info = {};
+        query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_create_info.queryCount = GpuProfiler::kMaxQueries;
+        for (auto& query_pool : m_timestamp_query_pools)
+            ASSERT_SUCCEEDED(vkCreateQueryPool(m_device, &query_pool_create_info, nullptr, &query_pool));
+    }
 
     VkSemaphoreCreateInfo semaphore_create_info = {};
     semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    ASSERT_SUCCEEDED(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_image_available_semaphore));
-    ASSERT_SUCCEEDED(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_rendering_finished_semaphore));
-
+    // Fences start signaled so that the first wait on every frame returns immediately
     VkFenceCreateInfo fence_create_info = {};
     fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    ASSERT_SUCCEEDED(vkCreateFence(m_device, &fence_create_info, nullptr, &m_fence));
+    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    m_image_available_semaphores.resize(m_frames_in_flight);
+    m_rendering_finished_semaphores.resize(m_frames_in_flight);
+    m_fences.resize(m_frames_in_flight);
+    for (uint32_t i = 0; i < m_frames_in_flight; ++i)
+    {
+        ASSERT_SUCCEEDED(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_image_available_semaphores[i]));
+        ASSERT_SUCCEEDED(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_rendering_finished_semaphores[i]));
+        ASSERT_SUCCEEDED(vkCreateFence(m_device, &fence_create_info, nullptr, &m_fences[i]));
+    }
 
-    ASSERT(frame_buffer_count == FrameCount);
     for (size_t i = 0; i < FrameCount; ++i)
     {
         descriptor_pool[i].reset(new VKDescriptorPool(*this));
     }
+    pipeline_cache.reset(new VKPipelineCache(*this));
+    render_pass_cache.reset(new VKRenderPassCache(*this));
+    view_cache.reset(new VKViewCache(*this));
+    upload_manager.reset(new VKUploadManager(*this));
+    constant_ring.reset(new ConstantRing(*this, m_frames_in_flight, device_properties.limits.minUniformBufferOffsetAlignment));
 
-    OpenCommandBuffer();
-
-    for (size_t i = 0; i < FrameCount; ++i)
+    for (size_t i = 0; i < m_images.size(); ++i)
     {
-        VKResource::Ptr res = std::make_shared<VKResource>();
+        VKResource::Ptr res = std::make_shared<VKResource>(*this);
         res->image.res = m_images[i];
         res->image.format = m_swapchain_color_format;
         res->image.size = { 1u * m_width, 1u * m_height };
         res->res_type = VKResource::Type::kImage;
-        m_back_buffers[i] = res;
+        m_back_buffers.emplace_back(res);
+    }
+
+    // Headless mode renders into one offscreen image per frame in flight instead of a swapchain
+    if (!m_window)
+    {
+        m_swapchain_color_format = VK_FORMAT_B8G8R8A8_UNORM;
+        for (uint32_t i = 0; i < m_frames_in_flight; ++i)
+        {
+            auto res = CreateTexture(BindFlag::kRtv, gli::format::FORMAT_BGRA8_UNORM_PACK8, 1, m_width, m_height);
+            m_back_buffers.emplace_back(std::static_pointer_cast<VKResource>(res));
+        }
     }
+
+    OpenCommandBuffer();
 }
 
 std::unique_ptr<ProgramApi> VKContext::CreateProgram()
@@ -357,15 +463,15 @@ VkFormat VKContext::findSupportedFormat(const std::vector<VkFormat>& candidates,
 
 Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, uint32_t msaa_count, int width, int height, int depth, int mip_levels)
 {
-    VKResource::Ptr res = std::make_shared<VKResource>();
+    VKResource::Ptr res = std::make_shared<VKResource>(*this);
     res->res_type = VKResource::Type::kImage;
 
     VkFormat vk_format = static_cast<VkFormat>(format);
     if (vk_format == VK_FORMAT_D24_UNORM_S8_UINT)
         vk_format = VK_FORMAT_D32_SFLOAT_S8_UINT;
 
-    auto createImage = [this, msaa_count](int width, int height, int depth, int mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-        VkImage& image, VkDeviceMemory& imageMemory, uint32_t& size)
+    auto createImage = [this, msaa_count](int width, int height, int depth, int mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VKHeapType heap_type,
+        VkImage& image, VKMemoryAllocation& imageMemory, uint32_t& size)
     {
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -381,7 +487,7 @@ Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, u
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = usage;
         imageInfo.samples = (VkSampleCountFlagBits)msaa_count;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        SetSharingMode(imageInfo.sharingMode, imageInfo.queueFamilyIndexCount, imageInfo.pQueueFamilyIndices);
 
         if (depth % 6 == 0)
             imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
@@ -393,18 +499,11 @@ Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, u
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(m_device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        imageMemory = memory_allocator->Allocate(memRequirements, heap_type, tiling == VK_IMAGE_TILING_LINEAR);
 
-        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
+        vkBindImageMemory(m_device, image, imageMemory.memory, imageMemory.offset);
 
-        vkBindImageMemory(m_device, image, imageMemory, 0);
-
-        size = allocInfo.allocationSize;
+        size = memRequirements.size;
     };
     
     VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
@@ -416,6 +515,9 @@ Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, u
         usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     if (bind_flag & BindFlag::kUav)
         usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    // Render targets may be copied out, e.g. the headless back buffers when a frame is read back
+    if (bind_flag & BindFlag::kRtv)
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
     uint32_t tmp = 0;
     createImage(
@@ -426,7 +528,7 @@ Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, u
         vk_format,
         VK_IMAGE_TILING_OPTIMAL,
         usage,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VKHeapType::kDeviceLocal,
         res->image.res,
         res->image.memory,
         tmp
@@ -442,19 +544,6 @@ Resource::Ptr VKContext::CreateTexture(uint32_t bind_flag, gli::format format, u
     return res;
 }
 
-uint32_t VKContext::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_physical_device, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
 Resource::Ptr VKContext::CreateBuffer(uint32_t bind_flag, uint32_t buffer_size, uint32_t stride)
 {
     if (buffer_size == 0)
@@ -463,38 +552,48 @@ Resource::Ptr VKContext::CreateBuffer(uint32_t bind_flag, uint32_t buffer_size,
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = buffer_size;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    SetSharingMode(bufferInfo.sharingMode, bufferInfo.queueFamilyIndexCount, bufferInfo.pQueueFamilyIndices);
 
     if (bind_flag & BindFlag::kVbv)
-        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    else if (bind_flag & BindFlag::kIbv)
-        bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    else if (bind_flag & BindFlag::kCbv)
-        bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    else if (bind_flag & BindFlag::kSrv)
-        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferInfo.usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    if (bind_flag & BindFlag::kIbv)
+        bufferInfo.usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    if (bind_flag & BindFlag::kCbv)
+        bufferInfo.usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    if (bind_flag & (BindFlag::kSrv | BindFlag::kUav))
+        bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (bind_flag & BindFlag::kIndirect)
+        bufferInfo.usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+    // Constant and CPU-written buffers are rewritten every frame and staging buffers are only read by copies,
+    // everything else is filled once through a staging copy and lives in device local memory
+    VKHeapType heap_type = VKHeapType::kDeviceLocal;
+    if (bind_flag == 0)
+    {
+        bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        heap_type = VKHeapType::kUpload;
+    }
+    else if (bind_flag & (BindFlag::kCbv | BindFlag::kCpuWrite))
+    {
+        heap_type = VKHeapType::kUpload;
+    }
     else
-        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    {
+        bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    }
 
-    VKResource::Ptr res = std::make_shared<VKResource>();
+    VKResource::Ptr res = std::make_shared<VKResource>(*this);
     res->res_type = VKResource::Type::kBuffer;
+    res->buffer.cpu_write = bind_flag != 0 && heap_type == VKHeapType::kUpload;
 
     vkCreateBuffer(m_device, &bufferInfo, nullptr, &res->buffer.res);
 
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_device, res->buffer.res, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &res->buffer.memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
+    res->buffer.memory = memory_allocator->Allocate(memRequirements, heap_type, true);
 
-    vkBindBufferMemory(m_device, res->buffer.res, res->buffer.memory, 0);
+    vkBindBufferMemory(m_device, res->buffer.res, res->buffer.memory.memory, res->buffer.memory.offset);
     res->buffer.size = buffer_size;
 
     return res;
@@ -502,7 +601,12 @@ Resource::Ptr VKContext::CreateBuffer(uint32_t bind_flag, uint32_t buffer_size,
 
 Resource::Ptr VKContext::CreateSampler(const SamplerDesc & desc)
 {
-    VKResource::Ptr res = std::make_shared<VKResource>();
+    std::lock_guard<std::mutex> lock(m_samplers_mutex);
+    auto it = m_samplers.find(desc);
+    if (it != m_samplers.end())
+        return it->second;
+
+    VKResource::Ptr res = std::make_shared<VKResource>(*this);
 
     VkSamplerCreateInfo samplerInfo = {};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -569,6 +673,7 @@ Resource::Ptr VKContext::CreateSampler(const SamplerDesc & desc)
     }
 
     res->res_type = VKResource::Type::kSampler;
+    m_samplers.emplace(desc, res);
     return res;
 }
 
@@ -586,153 +691,227 @@ VkImageAspectFlags VKContext::GetAspectFlags(VkFormat format)
     }
 }
 
+thread_local VKContext::ParallelRecording* VKContext::t_recording = nullptr;
+
+// Stages and accesses a compute-only queue is able to synchronize
+static constexpr VkPipelineStageFlags kComputeQueueStages =
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT |
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+    VK_PIPELINE_STAGE_TRANSFER_BIT |
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT |
+    VK_PIPELINE_STAGE_HOST_BIT |
+    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+static constexpr VkAccessFlags kComputeQueueAccess =
+    VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+    VK_ACCESS_UNIFORM_READ_BIT |
+    VK_ACCESS_SHADER_READ_BIT |
+    VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_TRANSFER_READ_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_READ_BIT |
+    VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_READ_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+// Pipeline stages and accesses that touch an image while it is in the given layout
+static void GetLayoutUsage(VkImageLayout layout, VkPipelineStageFlags& stages, VkAccessFlags& access)
+{
+    const VkPipelineStageFlags shader_stages =
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT |
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+        // Contents are discarded, nothing has to be waited for
+        stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        access = 0;
+        break;
+    case VK_IMAGE_LAYOUT_PREINITIALIZED:
+        stages = VK_PIPELINE_STAGE_HOST_BIT;
+        access = VK_ACCESS_HOST_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        stages = shader_stages;
+        access = VK_ACCESS_SHADER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_GENERAL:
+        stages = shader_stages;
+        access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access = VK_ACCESS_TRANSFER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access = VK_ACCESS_TRANSFER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        // Matches the wait stage of the image available semaphore in Submit
+        stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access = 0;
+        break;
+    default:
+        stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        break;
+    }
+}
+
 void VKContext::TransitionImageLayout(VKResource::Image& image, VkImageLayout newLayout, const ViewDesc& view_desc)
 {
-    VkImageSubresourceRange range = {};
-    range.aspectMask = GetAspectFlags(image.format);
-    range.baseMipLevel = view_desc.level;
+    uint32_t base_level = view_desc.level;
+    uint32_t level_count = 0;
     if (newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-        range.levelCount = 1;
+        level_count = 1;
     else if (view_desc.count == -1)
-        range.levelCount = image.level_count - view_desc.level;
+        level_count = image.level_count - view_desc.level;
     else
-        range.levelCount = view_desc.count;
-    range.baseArrayLayer = 0;
-    range.layerCount = image.array_layers;
-
-    std::vector<VkImageMemoryBarrier> image_memory_barriers;
+        level_count = view_desc.count;
+    uint32_t layer_count = image.array_layers;
 
-    for (uint32_t i = 0; i < range.levelCount; ++i)
+    // Recording threads share the layout state and run inside a render pass, so they can only verify it
+    if (t_recording)
     {
-        for (uint32_t j = 0; j < range.layerCount; ++j)
+        for (uint32_t level = base_level; level < base_level + level_count; ++level)
         {
-            VkImageSubresourceRange barrier_range = range;
-            barrier_range.baseMipLevel = range.baseMipLevel + i;
-            barrier_range.levelCount = 1;
-            barrier_range.baseArrayLayer = range.baseArrayLayer + j;
-            barrier_range.layerCount = 1;
+            for (uint32_t layer = 0; layer < layer_count; ++layer)
+            {
+                if (image.GetLayout(level, layer) != newLayout)
+                    throw std::runtime_error("Image layout transition inside ExecuteInParallel");
+            }
+        }
+        return;
+    }
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.res;
+    barrier.subresourceRange.aspectMask = GetAspectFlags(image.format);
 
-            if (image.layout[barrier_range] == newLayout)
+    // Runs of layers sharing the old layout become one barrier, and a level whose whole
+    // run matches the previous level extends that barrier instead of adding a new one
+    std::vector<VkImageMemoryBarrier> image_memory_barriers;
+    for (uint32_t level = base_level; level < base_level + level_count; ++level)
+    {
+        size_t level_begin = image_memory_barriers.size();
+        for (uint32_t layer = 0; layer < layer_count; ++layer)
+        {
+            VkImageLayout old_layout = image.GetLayout(level, layer);
+            if (old_layout == newLayout)
                 continue;
+            image.SetLayout(level, layer, newLayout);
 
-            image_memory_barriers.emplace_back();
-            VkImageMemoryBarrier& imageMemoryBarrier = image_memory_barriers.back();
-            imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            imageMemoryBarrier.oldLayout = image.layout[barrier_range];
-
-            imageMemoryBarrier.newLayout = newLayout;
-            imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            imageMemoryBarrier.image = image.res;
-            imageMemoryBarrier.subresourceRange = barrier_range;
-
-            // Source layouts (old)
-            // Source access mask controls actions that have to be finished on the old layout
-            // before it will be transitioned to the new layout
-            switch (image.layout[barrier_range])
+            if (image_memory_barriers.size() > level_begin)
             {
-            case VK_IMAGE_LAYOUT_UNDEFINED:
-                // Image layout is undefined (or does not matter)
-                // Only valid as initial layout
-                // No flags required, listed only for completeness
-                imageMemoryBarrier.srcAccessMask = 0;
-                break;
-
-            case VK_IMAGE_LAYOUT_PREINITIALIZED:
-                // Image is preinitialized
-                // Only valid as initial layout for linear images, preserves memory contents
-                // Make sure host writes have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-                // Image is a color attachment
-                // Make sure any writes to the color buffer have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-                // Image is a depth/stencil attachment
-                // Make sure any writes to the depth/stencil buffer have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-                // Image is a transfer source 
-                // Make sure any reads from the image have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-                // Image is a transfer destination
-                // Make sure any writes to the image have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-                // Image is read by a shader
-                // Make sure any shader reads from the image have been finished
-                imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-                break;
-            default:
-                // Other source layouts aren't handled (yet)
-                break;
+                VkImageMemoryBarrier& last = image_memory_barriers.back();
+                if (last.oldLayout == old_layout && last.subresourceRange.baseArrayLayer + last.subresourceRange.layerCount == layer)
+                {
+                    ++last.subresourceRange.layerCount;
+                    continue;
+                }
             }
 
-            // Target layouts (new)
-            // Destination access mask controls the dependency for the new image layout
-            switch (newLayout)
+            barrier.oldLayout = old_layout;
+            barrier.subresourceRange.baseMipLevel = level;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = layer;
+            barrier.subresourceRange.layerCount = 1;
+            image_memory_barriers.push_back(barrier);
+        }
+
+        if (level_begin > 0 && image_memory_barriers.size() == level_begin + 1)
+        {
+            VkImageMemoryBarrier& prev = image_memory_barriers[level_begin - 1];
+            const VkImageMemoryBarrier& cur = image_memory_barriers[level_begin];
+            if (prev.oldLayout == cur.oldLayout &&
+                prev.subresourceRange.baseArrayLayer == cur.subresourceRange.baseArrayLayer &&
+                prev.subresourceRange.layerCount == cur.subresourceRange.layerCount &&
+                prev.subresourceRange.baseMipLevel + prev.subresourceRange.levelCount == level)
             {
-            case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-                // Image will be used as a transfer destination
-                // Make sure any writes to the image have been finished
-                imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-                // Image will be used as a transfer source
-                // Make sure any reads from the image have been finished
-                imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-                // Image will be used as a color attachment
-                // Make sure any writes to the color buffer have been finished
-                imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-                // Image layout will be used as a depth/stencil attachment
-                // Make sure any writes to depth/stencil buffer have been finished
-                imageMemoryBarrier.dstAccessMask = imageMemoryBarrier.dstAccessMask | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-                break;
-
-            case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-                // Image will be read in a shader (sampler, input attachment)
-                // Make sure any writes to the image have been finished
-                if (imageMemoryBarrier.srcAccessMask == 0)
-                {
-                    imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
-                }
-                imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-                break;
-            default:
-                // Other source layouts aren't handled (yet)
-                break;
+                ++prev.subresourceRange.levelCount;
+                image_memory_barriers.pop_back();
             }
+        }
+    }
+
+    if (image_memory_barriers.empty())
+        return;
+
+    // Pending uploads have to land before the image leaves the layout they were recorded for
+    upload_manager->Flush();
 
-            image.layout[barrier_range] = newLayout;
+    // Two transitions of the same image can't share one vkCmdPipelineBarrier
+    if (m_pending_barrier_images.count(image.res))
+        FlushBarriers();
+    m_pending_barrier_images.insert(image.res);
+
+    VkPipelineStageFlags dst_stages = 0;
+    VkAccessFlags dst_access = 0;
+    GetLayoutUsage(newLayout, dst_stages, dst_access);
+    m_pending_dst_stages |= dst_stages;
+
+    for (auto& image_memory_barrier : image_memory_barriers)
+    {
+        VkPipelineStageFlags src_stages = 0;
+        VkAccessFlags src_access = 0;
+        GetLayoutUsage(image_memory_barrier.oldLayout, src_stages, src_access);
+        m_pending_src_stages |= src_stages;
+
+        image_memory_barrier.srcAccessMask = src_access;
+        image_memory_barrier.dstAccessMask = dst_access;
+        m_pending_image_barriers.push_back(image_memory_barrier);
+    }
+}
+
+void VKContext::FlushBarriers()
+{
+    if (m_pending_image_barriers.empty())
+        return;
+
+    // Layout transitions are not allowed inside a render pass instance
+    EndRenderPass();
+
+    if (m_is_async_compute)
+    {
+        // Graphics accesses of the old layout are already covered by the semaphore the compute submission waits on
+        for (auto& image_memory_barrier : m_pending_image_barriers)
+        {
+            image_memory_barrier.srcAccessMask &= kComputeQueueAccess;
+            image_memory_barrier.dstAccessMask &= kComputeQueueAccess;
         }
     }
 
     vkCmdPipelineBarrier(
-        m_cmd_bufs[m_frame_index],
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT,
+        GetCommandBuffer(),
+        GetSupportedStages(m_pending_src_stages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+        GetSupportedStages(m_pending_dst_stages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+        0,
         0, nullptr,
         0, nullptr,
-        image_memory_barriers.size(), image_memory_barriers.data());
-};
+        m_pending_image_barriers.size(), m_pending_image_barriers.data());
+
+    m_pending_image_barriers.clear();
+    m_pending_barrier_images.clear();
+    m_pending_src_stages = 0;
+    m_pending_dst_stages = 0;
+}
 
 void VKContext::UpdateSubresource(const Resource::Ptr & ires, uint32_t DstSubresource, const void * pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch)
 {
@@ -742,100 +921,44 @@ void VKContext::UpdateSubresource(const Resource::Ptr & ires, uint32_t DstSubres
 
     if (res->res_type == VKResource::Type::kBuffer)
     {
-        void* data;
-        vkMapMemory(m_device, res->buffer.memory, 0, res->buffer.size, 0, &data);
-        memcpy(data, pSrcData, (size_t)res->buffer.size);
-        vkUnmapMemory(m_device, res->buffer.memory);
+        UpdateBuffer(res, 0, pSrcData, res->buffer.size);
     }
     else if (res->res_type == VKResource::Type::kImage)
     {
-        auto staging = res->GetUploadResource(DstSubresource);
-        if (!staging || staging->res_type == VKResource::Type::kUnknown)
-            staging = std::static_pointer_cast<VKResource>(CreateBuffer(0, SrcDepthPitch, 0));
-        UpdateSubresource(staging, 0, pSrcData, SrcRowPitch, SrcDepthPitch);
-
-        // Setup buffer copy regions for each mip level
-        std::vector<VkBufferImageCopy> bufferCopyRegions;
-        uint32_t offset = 0;
-
-        VkBufferImageCopy bufferCopyRegion = {};
-        bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        bufferCopyRegion.imageSubresource.mipLevel = DstSubresource;
-        bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-        bufferCopyRegion.imageSubresource.layerCount = 1;
-        bufferCopyRegion.imageExtent.width = std::max(1u, static_cast<uint32_t>(res->image.size.width >> DstSubresource));
-        bufferCopyRegion.imageExtent.height = std::max(1u, static_cast<uint32_t>(res->image.size.height >> DstSubresource));
-        bufferCopyRegion.imageExtent.depth = 1;
-
-        bufferCopyRegions.push_back(bufferCopyRegion);
-
-        // The sub resource range describes the regions of the image that will be transitioned using the memory barriers below
-        VkImageSubresourceRange subresourceRange = {};
-        // Image only contains color data
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        // Start at first mip level
-        subresourceRange.baseMipLevel = DstSubresource;
-        // We will transition on all mip levels
-        subresourceRange.levelCount = 1;
-        // The 2D texture only has one layer
-        subresourceRange.layerCount = 1;
-
-        // Transition the texture image layout to transfer target, so we can safely copy our buffer data to it.
-        VkImageMemoryBarrier imageMemoryBarrier{};
-        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrier.image = res->image.res;
-        imageMemoryBarrier.subresourceRange = subresourceRange;
-        imageMemoryBarrier.srcAccessMask = 0;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-
-        // Insert a memory dependency at the proper pipeline stages that will execute the image layout transition 
-        // Source pipeline stage is host write/read exection (VK_PIPELINE_STAGE_HOST_BIT)
-        // Destination pipeline stage is copy command exection (VK_PIPELINE_STAGE_TRANSFER_BIT)
-        vkCmdPipelineBarrier(
-            m_cmd_bufs[m_frame_index],
-            VK_PIPELINE_STAGE_HOST_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &imageMemoryBarrier);
-
-        // Copy mip levels from staging buffer
-        vkCmdCopyBufferToImage(
-            m_cmd_bufs[m_frame_index],
-            staging->buffer.res,
-            res->image.res,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            static_cast<uint32_t>(bufferCopyRegions.size()),
-            bufferCopyRegions.data());
-
-        // Once the data has been uploaded we transfer to the texture image to the shader read layout, so it can be sampled from
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-        // Insert a memory dependency at the proper pipeline stages that will execute the image layout transition 
-        // Source pipeline stage stage is copy command exection (VK_PIPELINE_STAGE_TRANSFER_BIT)
-        // Destination pipeline stage fragment shader access (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
-        vkCmdPipelineBarrier(
-            m_cmd_bufs[m_frame_index],
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &imageMemoryBarrier);
-
-        // Store current layout for later reuse
-        res->image.layout[subresourceRange] = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        upload_manager->UpdateImage(*res, DstSubresource, pSrcData, SrcDepthPitch);
     }
 }
 
+void VKContext::UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size)
+{
+    if (!ires)
+        return;
+    auto res = std::static_pointer_cast<VKResource>(ires);
+    CheckBufferRange(ires, offset, size);
+    if (res->buffer.cpu_write)
+        memcpy(res->buffer.memory.mapped + offset, pSrcData, size);
+    else
+        upload_manager->UpdateBuffer(*res, offset, pSrcData, size);
+}
+
+uint64_t VKContext::GetBufferSize(const Resource::Ptr& ires) const
+{
+    return static_cast<VKResource&>(*ires).buffer.size;
+}
+
+uint8_t* VKContext::MapBuffer(const Resource::Ptr& ires)
+{
+    auto res = std::static_pointer_cast<VKResource>(ires);
+    if (!res->buffer.cpu_write)
+        return nullptr;
+    return res->buffer.memory.mapped;
+}
+
+void VKContext::FlushBuffer(const Resource::Ptr& ires, uint64_t offset, uint64_t size)
+{
+    // Upload heap memory is always host coherent, nothing to flush
+}
+
 void VKContext::SetViewport(float width, float height)
 {
     VkViewport viewport{};
@@ -843,7 +966,16 @@ void VKContext::SetViewport(float width, float height)
     viewport.height = height;
     viewport.minDepth = 0;
     viewport.maxDepth = 1.0;
-    vkCmdSetViewport(m_cmd_bufs[m_frame_index], 0, 1, &viewport);
+    if (t_recording)
+    {
+        vkCmdSetViewport(t_recording->cmd_buf, 0, 1, &viewport);
+        VkRect2D rect2D = { { 0, 0 }, { static_cast<uint32_t>(width), static_cast<uint32_t>(height) } };
+        vkCmdSetScissor(t_recording->cmd_buf, 0, 1, &rect2D);
+        return;
+    }
+
+    m_viewport = viewport;
+    vkCmdSetViewport(m_cmd_buf, 0, 1, &m_viewport);
 
     SetScissorRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
 }
@@ -855,22 +987,27 @@ void VKContext::SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t
     rect2D.extent.height = bottom;
     rect2D.offset.x = left;
     rect2D.offset.y = top;
-    vkCmdSetScissor(m_cmd_bufs[m_frame_index], 0, 1, &rect2D);
+    if (t_recording)
+    {
+        vkCmdSetScissor(t_recording->cmd_buf, 0, 1, &rect2D);
+        return;
+    }
+
+    m_scissor = rect2D;
+    vkCmdSetScissor(m_cmd_buf, 0, 1, &m_scissor);
 }
 
 void VKContext::UseProgram(ProgramApi& program)
 {
     auto& program_api = static_cast<VKProgramApi&>(program);
-    if (m_current_program != &program_api)
-    {
-        if (m_is_open_render_pass)
-        {
-            vkCmdEndRenderPass(m_cmd_bufs[GetFrameIndex()]);
-            m_is_open_render_pass = false;
-        }
-    }
-    m_current_program = &program_api;
-    m_current_program->UseProgram();
+    // Backend objects are created on the owning thread, programs of parallel tasks are finished before recording
+    ASSERT(!t_recording || !program_api.IsCompilationPending());
+    program_api.FinishCompilation();
+    if (t_recording)
+        t_recording->program = &program_api;
+    else
+        m_current_program = &program_api;
+    program_api.UseProgram();
 }
 
 void VKContext::IASetIndexBuffer(Resource::Ptr ires, gli::format Format)
@@ -890,7 +1027,7 @@ void VKContext::IASetIndexBuffer(Resource::Ptr ires, gli::format Format)
         break;
     }
 
-    vkCmdBindIndexBuffer(m_cmd_bufs[m_frame_index], res->buffer.res, 0, index_type);
+    vkCmdBindIndexBuffer(GetGraphicsCommandBuffer(), res->buffer.res, 0, index_type);
 }
 
 void VKContext::IASetVertexBuffer(uint32_t slot, Resource::Ptr ires)
@@ -898,91 +1035,201 @@ void VKContext::IASetVertexBuffer(uint32_t slot, Resource::Ptr ires)
     VKResource::Ptr res = std::static_pointer_cast<VKResource>(ires);
     VkBuffer vertexBuffers[] = { res->buffer.res };
     VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(m_cmd_bufs[m_frame_index], slot, 1, vertexBuffers, offsets);
+    vkCmdBindVertexBuffers(GetGraphicsCommandBuffer(), slot, 1, vertexBuffers, offsets);
 }
 
 void VKContext::BeginEvent(const std::string& name)
 {
+    WriteTimestamp(m_gpu_profiler.BeginEvent(m_frame_index, name));
+
     static decltype(&vkCmdBeginDebugUtilsLabelEXT) vkCmdBeginDebugUtilsLabelEXT_fn = decltype(&vkCmdBeginDebugUtilsLabelEXT)(vkGetDeviceProcAddr(m_device, "vkCmdBeginDebugUtilsLabelEXT"));
     if (!vkCmdBeginDebugUtilsLabelEXT_fn)
         return;
     VkDebugUtilsLabelEXT label = {};
     label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
     label.pLabelName = name.c_str();
-    vkCmdBeginDebugUtilsLabelEXT_fn(m_cmd_bufs[m_frame_index], &label);
+    vkCmdBeginDebugUtilsLabelEXT_fn(GetCommandBuffer(), &label);
 }
 
 void VKContext::EndEvent()
 {
     static decltype(&vkCmdEndDebugUtilsLabelEXT) vkCmdEndDebugUtilsLabelEXT_fn = decltype(&vkCmdEndDebugUtilsLabelEXT)(vkGetDeviceProcAddr(m_device, "vkCmdEndDebugUtilsLabelEXT"));
-    if (!vkCmdEndDebugUtilsLabelEXT_fn)
+    if (vkCmdEndDebugUtilsLabelEXT_fn)
+        vkCmdEndDebugUtilsLabelEXT_fn(GetCommandBuffer());
+
+    WriteTimestamp(m_gpu_profiler.EndEvent(m_frame_index));
+}
+
+void VKContext::WriteTimestamp(uint32_t query)
+{
+    // Async compute sections are measured on the graphics timeline, which waits for them
+    VkQueryPool query_pool = m_timestamp_query_pools[m_frame_index];
+    if (query_pool == VK_NULL_HANDLE || query == GpuProfiler::kInvalidQuery)
         return;
-    vkCmdEndDebugUtilsLabelEXT_fn(m_cmd_bufs[m_frame_index]);
+    vkCmdWriteTimestamp(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, query);
 }
 
-void VKContext::DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation)
+void VKContext::ResolveTimestamps()
 {
+    VkQueryPool query_pool = m_timestamp_query_pools[m_frame_index];
+    uint32_t query_count = m_gpu_profiler.GetQueryCount(m_frame_index);
+    if (query_pool != VK_NULL_HANDLE && query_count)
+    {
+        // The fence of the frame is signaled, so reading the results does not wait
+        std::vector<uint64_t> timestamps(query_count);
+        VkResult res = vkGetQueryPoolResults(m_device, query_pool, 0, query_count, timestamps.size() * sizeof(uint64_t),
+            timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (res == VK_SUCCESS)
+        {
+            uint64_t mask = m_timestamp_valid_bits >= 64 ? ~0ull : (1ull << m_timestamp_valid_bits) - 1;
+            for (auto& timestamp : timestamps)
+                timestamp &= mask;
+            m_gpu_profiler.Resolve(m_frame_index, timestamps.data(), m_timestamp_period);
+        }
+    }
+    m_gpu_profiler.OnFrameBegin(m_frame_index);
+}
+
+void VKContext::EndRenderPass()
+{
+    if (!m_is_open_render_pass)
+        return;
+    vkCmdEndRenderPass(m_cmd_buf);
+    m_is_open_render_pass = false;
+}
+
+VkCommandBuffer VKContext::PrepareDraw()
+{
+    if (t_recording)
+    {
+        // Uploads and barriers were resolved by the thread that opened the render pass
+        t_recording->program->ApplyBindings();
+        return t_recording->cmd_buf;
+    }
+
+    ASSERT(!m_is_async_compute);
+    upload_manager->Flush();
     m_current_program->ApplyBindings();
+    FlushBarriers();
 
+    // Programs writing the same views share one framebuffer, so the open render pass
+    // is reused across them unless the program has pending clears
     auto rp = m_current_program->GetRenderPass();
     auto fb = m_current_program->GetFramebuffer();
-    if (rp != m_render_pass || fb != m_framebuffer)
+    if (!m_is_open_render_pass || fb != m_framebuffer || m_current_program->HasPendingClear())
     {
-        if (m_is_open_render_pass)
-            vkCmdEndRenderPass(m_cmd_bufs[GetFrameIndex()]);
+        EndRenderPass();
         m_render_pass = rp;
         m_framebuffer = fb;
         m_current_program->RenderPassBegin();
         m_is_open_render_pass = true;
     }
-    vkCmdDrawIndexed(m_cmd_bufs[m_frame_index], IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0);
+    return m_cmd_buf;
+}
+
+void VKContext::DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
+{
+    vkCmdDrawIndexed(PrepareDraw(), IndexCount, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void VKContext::DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count)
+{
+    if (!args || draw_count == 0)
+        return;
+    auto res = std::static_pointer_cast<VKResource>(args);
+    VkCommandBuffer cmd = PrepareDraw();
+    uint32_t stride = sizeof(DrawIndexedIndirectCommand);
+    if (m_is_multi_draw_indirect_supported)
+    {
+        vkCmdDrawIndexedIndirect(cmd, res->buffer.res, offset, draw_count, stride);
+        return;
+    }
+    for (uint32_t i = 0; i < draw_count; ++i)
+        vkCmdDrawIndexedIndirect(cmd, res->buffer.res, offset + i * stride, 1, stride);
 }
 
 void VKContext::Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ)
 {
+    if (t_recording)
+        throw std::runtime_error("Dispatch is not allowed inside ExecuteInParallel");
+
+    upload_manager->Flush();
+    EndRenderPass();
     m_current_program->ApplyBindings();
-    vkCmdDispatch(m_cmd_bufs[m_frame_index], ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+    FlushBarriers();
+    vkCmdDispatch(GetCommandBuffer(), ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
 }
 
 Resource::Ptr VKContext::GetBackBuffer()
 {
-    return m_back_buffers[m_frame_index];
+    return m_back_buffers[m_image_index];
 }
 
 void VKContext::CloseCommandBuffer()
 {
-    if (m_is_open_render_pass)
+    ASSERT(!m_is_async_compute);
+
+    upload_manager->Flush();
+    EndRenderPass();
+
+    if (m_swapchain != VK_NULL_HANDLE)
+        TransitionImageLayout(m_back_buffers[m_image_index]->image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, {});
+    FlushBarriers();
+
+    // Compute work nobody waited for still has to finish before the frame fence is signaled
+    if (m_compute_finished != VK_NULL_HANDLE)
     {
-        vkCmdEndRenderPass(m_cmd_bufs[m_frame_index]);
-        m_is_open_render_pass = false;
+        m_wait_semaphores.push_back(m_compute_finished);
+        m_wait_stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        m_compute_finished = VK_NULL_HANDLE;
     }
 
-    TransitionImageLayout(m_back_buffers[m_frame_index]->image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, {});
-
-    auto res = vkEndCommandBuffer(m_cmd_bufs[m_frame_index]);
+    auto res = vkEndCommandBuffer(m_cmd_buf);
 }
 
 void VKContext::Submit()
+{
+    if (m_swapchain != VK_NULL_HANDLE)
+        SubmitCommandBuffer(m_rendering_finished_semaphores[m_frame_index], m_fences[m_frame_index]);
+    else
+        SubmitCommandBuffer(VK_NULL_HANDLE, m_fences[m_frame_index]);
+}
+
+void VKContext::SubmitCommandBuffer(VkSemaphore signal_semaphore, VkFence fence)
 {
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_cmd_bufs[m_frame_index];
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &m_image_available_semaphore;
-    VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    submitInfo.pWaitDstStageMask = &waitDstStageMask;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_rendering_finished_semaphore;
-
-    auto res = vkQueueSubmit(m_queue, 1, &submitInfo, m_fence);
-
-    res = vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
-    if (res != VK_SUCCESS)
+    submitInfo.pCommandBuffers = &m_cmd_buf;
+    submitInfo.waitSemaphoreCount = m_wait_semaphores.size();
+    submitInfo.pWaitSemaphores = m_wait_semaphores.data();
+    submitInfo.pWaitDstStageMask = m_wait_stages.data();
+    if (signal_semaphore != VK_NULL_HANDLE)
     {
-        throw std::runtime_error("vkWaitForFences");
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &signal_semaphore;
     }
-    vkResetFences(m_device, 1, &m_fence);
+
+    ASSERT_SUCCEEDED(vkQueueSubmit(m_queue, 1, &submitInfo, fence));
+
+    m_wait_semaphores.clear();
+    m_wait_stages.clear();
+}
+
+void VKContext::SplitCommandBuffer(VkSemaphore signal_semaphore)
+{
+    upload_manager->Flush();
+    FlushBarriers();
+    EndRenderPass();
+    ASSERT_SUCCEEDED(vkEndCommandBuffer(m_cmd_buf));
+    SubmitCommandBuffer(signal_semaphore, VK_NULL_HANDLE);
+
+    // Dynamic state does not survive the command buffer boundary
+    m_cmd_buf = BeginCommandBuffer(m_cmd_pool, m_cmd_bufs[m_frame_index], m_cmd_buf_count);
+    if (m_viewport.width > 0)
+        vkCmdSetViewport(m_cmd_buf, 0, 1, &m_viewport);
+    if (m_scissor.extent.width > 0)
+        vkCmdSetScissor(m_cmd_buf, 0, 1, &m_scissor);
 }
 
 void VKContext::SwapBuffers()
@@ -991,30 +1238,268 @@ void VKContext::SwapBuffers()
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &m_swapchain;
-    presentInfo.pImageIndices = &m_frame_index;
+    presentInfo.pImageIndices = &m_image_index;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &m_rendering_finished_semaphore;
+    presentInfo.pWaitSemaphores = &m_rendering_finished_semaphores[m_frame_index];
 
     auto res = vkQueuePresentKHR(m_queue, &presentInfo);
 }
 
-void VKContext::OpenCommandBuffer()
+void VKContext::WaitForFrame()
+{
+    // Only the frame whose resources are about to be reused has to be finished on the GPU
+    if (vkWaitForFences(m_device, 1, &m_fences[m_frame_index], VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("vkWaitForFences");
+    }
+    vkResetFences(m_device, 1, &m_fences[m_frame_index]);
+}
+
+VkCommandBuffer VKContext::BeginCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& cmd_bufs, size_t& used_count,
+    const VkCommandBufferInheritanceInfo* inheritance_info)
 {
-    vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_available_semaphore, nullptr, &m_frame_index);
+    if (used_count == cmd_bufs.size())
+    {
+        VkCommandBufferAllocateInfo cmd_buf_alloc_info = {};
+        cmd_buf_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd_buf_alloc_info.commandPool = pool;
+        cmd_buf_alloc_info.commandBufferCount = 1;
+        cmd_buf_alloc_info.level = inheritance_info ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd_bufs.emplace_back();
+        ASSERT_SUCCEEDED(vkAllocateCommandBuffers(m_device, &cmd_buf_alloc_info, &cmd_bufs.back()));
+    }
+    VkCommandBuffer cmd_buf = cmd_bufs[used_count++];
 
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    auto res = vkBeginCommandBuffer(m_cmd_bufs[m_frame_index], &beginInfo);
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (inheritance_info)
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = inheritance_info;
+    ASSERT_SUCCEEDED(vkBeginCommandBuffer(cmd_buf, &beginInfo));
+    return cmd_buf;
+}
+
+VkSemaphore VKContext::GetQueueSemaphore()
+{
+    auto& semaphores = m_queue_semaphores[m_frame_index];
+    if (m_queue_semaphore_count == semaphores.size())
+    {
+        VkSemaphoreCreateInfo semaphore_create_info = {};
+        semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphores.emplace_back();
+        ASSERT_SUCCEEDED(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &semaphores.back()));
+    }
+    return semaphores[m_queue_semaphore_count++];
+}
+
+void VKContext::OpenCommandBuffer()
+{
+    WaitForFrame();
+
+    // Command buffers and semaphores of this slot are free again once its fence is signaled
+    m_cmd_buf_count = 0;
+    m_compute_cmd_buf_count = 0;
+    m_queue_semaphore_count = 0;
+    m_bound_sets_program = nullptr;
+    for (auto& worker_cmd_pool : m_worker_cmd_pools)
+        worker_cmd_pool.used_count = 0;
+
+    if (m_swapchain != VK_NULL_HANDLE)
+    {
+        vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_available_semaphores[m_frame_index], nullptr, &m_image_index);
+        m_wait_semaphores.push_back(m_image_available_semaphores[m_frame_index]);
+        m_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    else
+    {
+        // The offscreen image of a frame is free once the fence of the frame is signaled
+        m_image_index = m_frame_index;
+    }
+
+    ResolveTimestamps();
+
+    m_cmd_buf = BeginCommandBuffer(m_cmd_pool, m_cmd_bufs[m_frame_index], m_cmd_buf_count);
+    if (m_timestamp_query_pools[m_frame_index] != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(m_cmd_buf, m_timestamp_query_pools[m_frame_index], 0, GpuProfiler::kMaxQueries);
+}
+
+bool VKContext::IsAsyncComputeSupported() const
+{
+    return m_compute_queue_family_index != m_queue_family_index;
+}
+
+void VKContext::BeginAsyncCompute()
+{
+    if (!IsAsyncComputeSupported())
+        return;
+    ASSERT(!m_is_async_compute);
+
+    // Everything recorded so far is submitted, the compute work waits for it on the GPU
+    VkSemaphore graphics_finished = GetQueueSemaphore();
+    SplitCommandBuffer(graphics_finished);
+    m_compute_wait_semaphore = graphics_finished;
+
+    m_compute_cmd_buf = BeginCommandBuffer(m_compute_cmd_pool, m_compute_cmd_bufs[m_frame_index], m_compute_cmd_buf_count);
+    m_is_async_compute = true;
+}
+
+void VKContext::EndAsyncCompute()
+{
+    if (!IsAsyncComputeSupported())
+        return;
+    ASSERT(m_is_async_compute);
+
+    upload_manager->Flush();
+    FlushBarriers();
+    ASSERT_SUCCEEDED(vkEndCommandBuffer(m_compute_cmd_buf));
+    m_is_async_compute = false;
+
+    // Work still waiting from an earlier section is chained so that one wait covers both
+    std::vector<VkSemaphore> wait_semaphores = { m_compute_wait_semaphore };
+    if (m_compute_finished != VK_NULL_HANDLE)
+        wait_semaphores.push_back(m_compute_finished);
+    std::vector<VkPipelineStageFlags> wait_stages(wait_semaphores.size(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    m_compute_finished = GetQueueSemaphore();
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_compute_cmd_buf;
+    submitInfo.waitSemaphoreCount = wait_semaphores.size();
+    submitInfo.pWaitSemaphores = wait_semaphores.data();
+    submitInfo.pWaitDstStageMask = wait_stages.data();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_compute_finished;
+    ASSERT_SUCCEEDED(vkQueueSubmit(m_compute_queue, 1, &submitInfo, VK_NULL_HANDLE));
+}
+
+void VKContext::WaitAsyncCompute()
+{
+    if (m_compute_finished == VK_NULL_HANDLE)
+        return;
+
+    // Graphics work recorded since EndAsyncCompute overlaps the compute work, what follows waits for it
+    SplitCommandBuffer(VK_NULL_HANDLE);
+    m_wait_semaphores.push_back(m_compute_finished);
+    m_wait_stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    m_compute_finished = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer VKContext::GetCommandBuffer() const
+{
+    if (t_recording)
+        return t_recording->cmd_buf;
+    return m_is_async_compute ? m_compute_cmd_buf : m_cmd_buf;
+}
+
+VkCommandBuffer VKContext::GetGraphicsCommandBuffer() const
+{
+    if (t_recording)
+        return t_recording->cmd_buf;
+    return m_cmd_buf;
+}
+
+bool VKContext::IsParallelRecordingSupported() const
+{
+    return true;
+}
+
+void VKContext::ExecuteInParallel(size_t task_count, const std::function<void(size_t task)>& task)
+{
+    ASSERT(!t_recording && !m_is_async_compute);
+    if (task_count == 0)
+        return;
+
+    // The render pass of the current program is begun here with its clears, tasks only continue it
+    upload_manager->Flush();
+    m_current_program->ApplyBindings();
+    FlushBarriers();
+    EndRenderPass();
+    m_render_pass = m_current_program->GetRenderPass();
+    m_framebuffer = m_current_program->GetFramebuffer();
+    m_current_program->RenderPassBegin(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    m_is_open_render_pass = true;
+
+    VkCommandBufferInheritanceInfo inheritance_info = {};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = m_render_pass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = m_framebuffer;
+
+    std::vector<VkCommandBuffer> cmd_bufs(task_count);
+    m_thread_pool->ParallelFor(task_count, [&](size_t worker, size_t index)
+    {
+        WorkerCommandPool& worker_cmd_pool = m_worker_cmd_pools[worker];
+        ParallelRecording recording = {};
+        recording.cmd_buf = BeginCommandBuffer(worker_cmd_pool.pool, worker_cmd_pool.cmd_bufs[m_frame_index], worker_cmd_pool.used_count, &inheritance_info);
+        recording.program = m_current_program;
+        if (m_viewport.width > 0)
+            vkCmdSetViewport(recording.cmd_buf, 0, 1, &m_viewport);
+        if (m_scissor.extent.width > 0)
+            vkCmdSetScissor(recording.cmd_buf, 0, 1, &m_scissor);
+
+        t_recording = &recording;
+        ScopeGuard guard([] { t_recording = nullptr; });
+        task(index);
+        ASSERT_SUCCEEDED(vkEndCommandBuffer(recording.cmd_buf));
+        cmd_bufs[index] = recording.cmd_buf;
+    });
+
+    vkCmdExecuteCommands(m_cmd_buf, static_cast<uint32_t>(cmd_bufs.size()), cmd_bufs.data());
+    // Bindings of the primary command buffer are undefined after executing secondary ones
+    m_bound_sets_program = nullptr;
+
+    // Draws after this point are recorded inline and need a pass of their own
+    EndRenderPass();
+}
+
+VKProgramApi*& VKContext::GetBoundSetsProgram()
+{
+    if (t_recording)
+        return t_recording->bound_sets_program;
+    return m_bound_sets_program;
+}
+
+VkPipelineStageFlags VKContext::GetSupportedStages(VkPipelineStageFlags stages, VkPipelineStageFlags fallback) const
+{
+    if (!m_is_async_compute)
+        return stages;
+    stages &= kComputeQueueStages;
+    return stages ? stages : fallback;
+}
+
+void VKContext::SetSharingMode(VkSharingMode& sharing_mode, uint32_t& queue_family_index_count, const uint32_t*& queue_family_indices) const
+{
+    // Resources are shared between the queues instead of transferring ownership around every compute section
+    if (IsAsyncComputeSupported())
+    {
+        sharing_mode = VK_SHARING_MODE_CONCURRENT;
+        queue_family_index_count = static_cast<uint32_t>(m_queue_family_indices.size());
+        queue_family_indices = m_queue_family_indices.data();
+    }
+    else
+    {
+        sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
+    }
 }
 
 void VKContext::Present()
 {
+    UpdateAttachStats();
     CloseCommandBuffer();
     Submit();
-    SwapBuffers();
+    if (m_swapchain != VK_NULL_HANDLE)
+        SwapBuffers();
+    upload_manager->OnFrameEnd(m_frame_index);
+
+    m_frame_index = (m_frame_index + 1) % m_frames_in_flight;
     OpenCommandBuffer();
 
+    ExecuteDeletionQueue(m_frame_index);
+    upload_manager->OnFrameBegin(m_frame_index);
+    constant_ring->OnFrameBegin(m_frame_index);
+
     descriptor_pool[m_frame_index]->OnFrameBegin();
     for (auto & x : m_created_program)
         x.get().OnPresent();
@@ -1024,7 +1509,110 @@ void VKContext::ResizeBackBuffer(int width, int height)
 {
 }
 
+void VKContext::OnDestroy()
+{
+    vkDeviceWaitIdle(m_device);
+    for (size_t i = 0; i < FrameCount; ++i)
+        ExecuteDeletionQueue(i);
+    pipeline_cache->Save();
+}
+
+void VKContext::QueryOnDelete(const VKResource::Image& image)
+{
+    VkImage res = image.res;
+    VKMemoryAllocation memory = image.memory;
+    std::lock_guard<std::mutex> lock(m_deletion_mutex);
+    m_deletion_queue[m_frame_index].emplace_back([this, res, memory]
+    {
+        view_cache->OnImageDelete(res);
+        vkDestroyImage(m_device, res, nullptr);
+        memory_allocator->Free(memory);
+    });
+}
+
+void VKContext::QueryOnDelete(const VKResource::Buffer& buffer)
+{
+    VkBuffer res = buffer.res;
+    VKMemoryAllocation memory = buffer.memory;
+    std::lock_guard<std::mutex> lock(m_deletion_mutex);
+    m_deletion_queue[m_frame_index].emplace_back([this, res, memory]
+    {
+        vkDestroyBuffer(m_device, res, nullptr);
+        memory_allocator->Free(memory);
+    });
+}
+
+void VKContext::QueryOnDelete(std::function<void()> deleter)
+{
+    std::lock_guard<std::mutex> lock(m_deletion_mutex);
+    m_deletion_queue[m_frame_index].emplace_back(std::move(deleter));
+}
+
+void VKContext::ExecuteDeletionQueue(size_t frame_index)
+{
+    for (auto& deleter : m_deletion_queue[frame_index])
+        deleter();
+    m_deletion_queue[frame_index].clear();
+}
+
 VKDescriptorPool& VKContext::GetDescriptorPool()
 {
     return *descriptor_pool[m_frame_index];
 }
+
+VKPipelineCache& VKContext::GetPipelineCache()
+{
+    return *pipeline_cache;
+}
+
+VKRenderPassCache& VKContext::GetRenderPassCache()
+{
+    return *render_pass_cache;
+}
+
+VKViewCache& VKContext::GetViewCache()
+{
+    return *view_cache;
+}
+
+VKMemoryAllocator& VKContext::GetMemoryAllocator()
+{
+    return *memory_allocator;
+}
+
+VKUploadManager& VKContext::GetUploadManager()
+{
+    return *upload_manager;
+}
+
+ConstantRing& VKContext::GetConstantRing()
+{
+    return *constant_ring;
+}
+
+uint32_t VKContext::GetMaxBindlessTextures() const
+{
+    return m_max_bindless_textures;
+}
+
+bool VKContext::GetMemoryStats(MemoryStats& stats) const
+{
+    const VKMemoryStats& memory_stats = memory_allocator->GetStats();
+    stats.memory_blocks = memory_stats.block_count;
+    stats.dedicated_allocations = memory_stats.dedicated_count;
+    stats.allocations = memory_stats.allocation_count;
+    stats.reserved_bytes = memory_stats.reserved_bytes;
+    stats.used_bytes = memory_stats.used_bytes;
+
+    stats.descriptor_pools = 0;
+    stats.peak_descriptor_sets = 0;
+    for (size_t i = 0; i < FrameCount; ++i)
+    {
+        const VKDescriptorPoolStats& pool_stats = descriptor_pool[i]->GetStats();
+        stats.descriptor_pools += pool_stats.num_pools;
+        stats.peak_descriptor_sets = std::max(stats.peak_descriptor_sets, pool_stats.peak_allocated_sets);
+    }
+    // The pool of the current frame is still being filled
+    stats.descriptor_sets = descriptor_pool[(m_frame_index + FrameCount - 1) % FrameCount]->GetStats().allocated_sets;
+    return true;
+}
@@ -1,11 +1,22 @@
 #pragma once
 
 #include "Context/Context.h"
+#include "Context/ConstantRing.h"
 #include "Context/VKDescriptorPool.h"
+#include "Context/VKPipelineCache.h"
+#include "Context/VKRenderPassCache.h"
+#include "Context/VKViewCache.h"
+#include "Context/VKMemoryAllocator.h"
+#include "Context/VKUploadManager.h"
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 #include <Geometry/IABuffer.h>
 #include <assimp/postprocess.h>
+#include <Utilities/ThreadPool.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
 
 struct VKProgramApi;
 class VKContext : public Context
@@ -16,17 +27,21 @@ public:
     void CreateDevice();
     void CreateSwapchain(int width, int height);
     void SelectPhysicalDevice();
-    VKContext(GLFWwindow* window);
+    VKContext(GLFWwindow* window, int width = 0, int height = 0);
 
     virtual std::unique_ptr<ProgramApi> CreateProgram() override;
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     virtual Resource::Ptr CreateTexture(uint32_t bind_flag, gli::format format, uint32_t msaa_count, int width, int height, int depth = 1, int mip_levels = 1) override;
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     virtual Resource::Ptr CreateBuffer(uint32_t bind_flag, uint32_t buffer_size, uint32_t stride) override;
     virtual Resource::Ptr CreateSampler(const SamplerDesc& desc) override;
     void TransitionImageLayout(VKResource::Image& image, VkImageLayout newLayout, const ViewDesc& view_desc);
+    void FlushBarriers();
     VkImageAspectFlags GetAspectFlags(VkFormat format);
     virtual void UpdateSubresource(const Resource::Ptr& ires, uint32_t DstSubresource, const void *pSrcData, uint32_t SrcRowPitch, uint32_t SrcDepthPitch) override;
+    virtual void UpdateBuffer(const Resource::Ptr& ires, uint64_t offset, const void* pSrcData, uint64_t size) override;
+    virtual uint8_t* MapBuffer(const Resource::Ptr& ires) override;
+    virtual uint64_t GetBufferSize(const Resource::Ptr& ires) const override;
+    virtual void FlushBuffer(const Resource::Ptr& ires, uint64_t offset, uint64_t size) override;
 
     virtual void SetViewport(float width, float height) override;
     virtual void SetScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom) override;
@@ -38,19 +53,58 @@ public:
 
     virtual void BeginEvent(const std::string& name) override;
     virtual void EndEvent() override;
+    void WriteTimestamp(uint32_t query);
+    void ResolveTimestamps();
 
-    virtual void DrawIndexed(uint32_t IndexCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation) override;
+    virtual bool IsAsyncComputeSupported() const override;
+    virtual void BeginAsyncCompute() override;
+    virtual void EndAsyncCompute() override;
+    virtual void WaitAsyncCompute() override;
+
+    virtual bool IsParallelRecordingSupported() const override;
+    virtual void ExecuteInParallel(size_t task_count, const std::function<void(size_t task)>& task) override;
+
+    virtual uint32_t GetMaxBindlessTextures() const override;
+    virtual bool GetMemoryStats(MemoryStats& stats) const override;
+
+    void EndRenderPass();
+    // Resolves bindings and the render pass of the current program, returns the command buffer to draw into
+    VkCommandBuffer PrepareDraw();
+    virtual void DrawIndexedInstanced(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+    virtual void DrawIndexedIndirect(const Resource::Ptr& args, uint32_t offset, uint32_t draw_count) override;
     virtual void Dispatch(uint32_t ThreadGroupCountX, uint32_t ThreadGroupCountY, uint32_t ThreadGroupCountZ) override;
 
     virtual Resource::Ptr GetBackBuffer() override;
     void CloseCommandBuffer();
     void Submit();
+    void SubmitCommandBuffer(VkSemaphore signal_semaphore, VkFence fence);
+    void SplitCommandBuffer(VkSemaphore signal_semaphore);
     void SwapBuffers();
+    void WaitForFrame();
+    VkCommandBuffer BeginCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& cmd_bufs, size_t& used_count,
+        const VkCommandBufferInheritanceInfo* inheritance_info = nullptr);
+    VkSemaphore GetQueueSemaphore();
     void OpenCommandBuffer();
+
+    // Command buffer receiving the current commands, the compute one inside an async compute section
+    VkCommandBuffer GetCommandBuffer() const;
+    VkCommandBuffer GetGraphicsCommandBuffer() const;
+    // Program whose descriptor sets were bound last into the current command buffer, reset when those bindings are lost
+    VKProgramApi*& GetBoundSetsProgram();
+    VkPipelineStageFlags GetSupportedStages(VkPipelineStageFlags stages, VkPipelineStageFlags fallback) const;
+    void SetSharingMode(VkSharingMode& sharing_mode, uint32_t& queue_family_index_count, const uint32_t*& queue_family_indices) const;
     virtual void Present() override;
 
     virtual void ResizeBackBuffer(int width, int height) override;
 
+    virtual void OnDestroy() override;
+
+    void QueryOnDelete(const VKResource::Image& image);
+    void QueryOnDelete(const VKResource::Buffer& buffer);
+    // Runs the deleter once the frames recorded so far are retired
+    void QueryOnDelete(std::function<void()> deleter);
+    void ExecuteDeletionQueue(size_t frame_index);
+
     VKProgramApi* m_current_program = nullptr;
 
     VkInstance m_instance = VK_NULL_HANDLE;
@@ -62,19 +116,103 @@ public:
     VkFormat m_swapchain_color_format = VK_FORMAT_B8G8R8_UNORM;
     VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> m_images;
+    uint32_t m_compute_queue_family_index = 0;
+    VkQueue m_compute_queue = VK_NULL_HANDLE;
+    std::vector<uint32_t> m_queue_family_indices;
+
+    // Graphics work of a frame is split into several submissions around async compute sections
     VkCommandPool m_cmd_pool = VK_NULL_HANDLE;
-    std::vector<VkCommandBuffer> m_cmd_bufs;
-    VkSemaphore m_image_available_semaphore = VK_NULL_HANDLE;
-    VkSemaphore m_rendering_finished_semaphore = VK_NULL_HANDLE;
-    VkFence m_fence = VK_NULL_HANDLE;;
+    std::vector<VkCommandBuffer> m_cmd_bufs[FrameCount];
+    size_t m_cmd_buf_count = 0;
+    VkCommandBuffer m_cmd_buf = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> m_wait_semaphores;
+    std::vector<VkPipelineStageFlags> m_wait_stages;
+    VkViewport m_viewport = {};
+    VkRect2D m_scissor = {};
+
+    VkCommandPool m_compute_cmd_pool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> m_compute_cmd_bufs[FrameCount];
+    size_t m_compute_cmd_buf_count = 0;
+    VkCommandBuffer m_compute_cmd_buf = VK_NULL_HANDLE;
+    bool m_is_async_compute = false;
+    VkSemaphore m_compute_wait_semaphore = VK_NULL_HANDLE;
+    VkSemaphore m_compute_finished = VK_NULL_HANDLE;
+
+    std::vector<VkSemaphore> m_queue_semaphores[FrameCount];
+    size_t m_queue_semaphore_count = 0;
+
+    VkQueryPool m_timestamp_query_pools[FrameCount] = {};
+    uint32_t m_timestamp_valid_bits = 0;
+    double m_timestamp_period = 0;
+
+    uint32_t m_max_bindless_textures = 0;
+    bool m_is_multi_draw_indirect_supported = false;
+
+    PFN_vkCreateDescriptorUpdateTemplateKHR m_vkCreateDescriptorUpdateTemplateKHR = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR m_vkDestroyDescriptorUpdateTemplateKHR = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR m_vkUpdateDescriptorSetWithTemplateKHR = nullptr;
+
+    // Secondary command buffers of one ExecuteInParallel worker
+    struct WorkerCommandPool
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> cmd_bufs[FrameCount];
+        size_t used_count = 0;
+    };
+    std::unique_ptr<ThreadPool> m_thread_pool;
+    std::vector<WorkerCommandPool> m_worker_cmd_pools;
+
+    // Task recording on the current thread inside ExecuteInParallel
+    struct ParallelRecording
+    {
+        VkCommandBuffer cmd_buf = VK_NULL_HANDLE;
+        VKProgramApi* program = nullptr;
+        VKProgramApi* bound_sets_program = nullptr;
+    };
+    static thread_local ParallelRecording* t_recording;
+    VKProgramApi* m_bound_sets_program = nullptr;
+    std::vector<VkSemaphore> m_image_available_semaphores;
+    std::vector<VkSemaphore> m_rendering_finished_semaphores;
+    std::vector<VkFence> m_fences;
+    uint32_t m_frames_in_flight = FrameCount;
+    uint32_t m_image_index = 0;
 
     VKDescriptorPool& GetDescriptorPool();
     std::unique_ptr<VKDescriptorPool> descriptor_pool[FrameCount];
 
+    VKPipelineCache& GetPipelineCache();
+    std::unique_ptr<VKPipelineCache> pipeline_cache;
+
+    VKRenderPassCache& GetRenderPassCache();
+    std::unique_ptr<VKRenderPassCache> render_pass_cache;
+
+    VKViewCache& GetViewCache();
+    std::unique_ptr<VKViewCache> view_cache;
+
+    // Passes ask for the same few samplers, identical descs share one resource
+    std::map<SamplerDesc, Resource::Ptr> m_samplers;
+    std::mutex m_samplers_mutex;
+
+    VKMemoryAllocator& GetMemoryAllocator();
+    std::unique_ptr<VKMemoryAllocator> memory_allocator;
+    std::vector<std::function<void()>> m_deletion_queue[FrameCount];
+    std::mutex m_deletion_mutex;
+
+    VKUploadManager& GetUploadManager();
+    std::unique_ptr<VKUploadManager> upload_manager;
+
+    ConstantRing& GetConstantRing();
+    std::unique_ptr<ConstantRing> constant_ring;
+
     VkRenderPass m_render_pass = VK_NULL_HANDLE;
     VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
     bool m_is_open_render_pass = false;
 
+    std::vector<VkImageMemoryBarrier> m_pending_image_barriers;
+    std::set<VkImage> m_pending_barrier_images;
+    VkPipelineStageFlags m_pending_src_stages = 0;
+    VkPipelineStageFlags m_pending_dst_stages = 0;
+
     std::vector<std::reference_wrapper<VKProgramApi>> m_created_program;
-    VKResource::Ptr m_back_buffers[FrameCount];
+    std::vector<VKResource::Ptr> m_back_buffers;
 };
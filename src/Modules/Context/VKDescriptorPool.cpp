@@ -6,55 +6,109 @@ VKDescriptorPool::VKDescriptorPool(VKContext & context)
 {
 }
 
+VKDescriptorPool::~VKDescriptorPool()
+{
+    for (auto& pool : m_pools)
+        vkDestroyDescriptorPool(m_context.m_device, pool, nullptr);
+}
+
 void VKDescriptorPool::ResizeHeap(const std::map<VkDescriptorType, size_t>& count)
 {
-    std::vector<VkDescriptorPoolSize> pool_sizes;
-    for (auto & x : count)
-    {
-        pool_sizes.emplace_back();
-        VkDescriptorPoolSize& pool_size = pool_sizes.back();
-        pool_size.type = x.first;
-        pool_size.descriptorCount = x.second;
-    }
+    static const VkDescriptorType types[] = {
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+    };
 
-    // TODO: fix me
-    if (count.empty())
+    // Every new pool is twice as large as the previous one, so the number of pools stays logarithmic
+    if (!m_pools.empty())
+        m_chunk_size *= 2;
+
+    std::vector<VkDescriptorPoolSize> pool_sizes;
+    for (auto type : types)
     {
         pool_sizes.emplace_back();
         VkDescriptorPoolSize& pool_size = pool_sizes.back();
-        pool_size.type = VK_DESCRIPTOR_TYPE_SAMPLER;
-        pool_size.descriptorCount = 1;
+        pool_size.type = type;
+        pool_size.descriptorCount = m_chunk_size;
+        auto it = count.find(type);
+        if (it != count.end())
+            pool_size.descriptorCount = std::max<uint32_t>(pool_size.descriptorCount, it->second);
     }
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = pool_sizes.size();
     poolInfo.pPoolSizes = pool_sizes.data();
-    poolInfo.maxSets = 1;
+    poolInfo.maxSets = m_chunk_size;
 
-    if (vkCreateDescriptorPool(m_context.m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(m_context.m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
     }
+    m_pools.push_back(pool);
+    m_stats.num_pools = m_pools.size();
 }
 
-VkDescriptorSet VKDescriptorPool::AllocateDescriptorSet(VkDescriptorSetLayout & set_layout, const std::map<VkDescriptorType, size_t>& count)
+bool VKDescriptorPool::TryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout& set_layout, VkDescriptorSet& descriptor_set)
 {
-    ResizeHeap(count);
-
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorPool = pool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &set_layout;
+    return vkAllocateDescriptorSets(m_context.m_device, &allocInfo, &descriptor_set) == VK_SUCCESS;
+}
 
-    VkDescriptorSet m_descriptor_set;
-    if (vkAllocateDescriptorSets(m_context.m_device, &allocInfo, &m_descriptor_set) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor set!");
+VkDescriptorSet VKDescriptorPool::AllocateDescriptorSet(VkDescriptorSetLayout & set_layout, const std::map<VkDescriptorType, size_t>& count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    while (m_pool_index < m_pools.size() && !TryAllocate(m_pools[m_pool_index], set_layout, descriptor_set))
+    {
+        ++m_pool_index;
     }
 
-    return m_descriptor_set;
+    if (m_pool_index == m_pools.size())
+    {
+        ResizeHeap(count);
+        if (!TryAllocate(m_pools.back(), set_layout, descriptor_set)) {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+    }
+
+    ++m_stats.allocated_sets;
+    m_stats.peak_allocated_sets = std::max(m_stats.peak_allocated_sets, m_stats.allocated_sets);
+    for (auto & x : count)
+        m_stats.allocated_descriptors[x.first] += x.second;
+
+    return descriptor_set;
 }
 
 void VKDescriptorPool::OnFrameBegin()
 {
+    // Merge the chunks of the previous frame into one pool of the largest size
+    if (m_pools.size() > 1)
+    {
+        for (auto& pool : m_pools)
+            vkDestroyDescriptorPool(m_context.m_device, pool, nullptr);
+        m_pools.clear();
+        m_stats.num_pools = 0;
+    }
+    for (auto& pool : m_pools)
+        vkResetDescriptorPool(m_context.m_device, pool, 0);
+    m_pool_index = 0;
+    m_stats.allocated_sets = 0;
+    m_stats.allocated_descriptors.clear();
+}
+
+const VKDescriptorPoolStats& VKDescriptorPool::GetStats() const
+{
+    return m_stats;
 }
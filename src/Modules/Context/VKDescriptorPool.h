@@ -1,26 +1,43 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include <algorithm>
+#include <mutex>
 #include <Resource/VKResource.h>
 
 class VKContext;
 
+struct VKDescriptorPoolStats
+{
+    size_t num_pools = 0;
+    size_t allocated_sets = 0;
+    size_t peak_allocated_sets = 0;
+    std::map<VkDescriptorType, size_t> allocated_descriptors;
+};
+
 class VKDescriptorPool
 {
 public:
     VKDescriptorPool(VKContext& context);
-
-
-    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    ~VKDescriptorPool();
 
     VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout& set_layout, const std::map<VkDescriptorType, size_t>& count);
 
+    // Must be called only after the fence of the frame that used this pool has been signaled
     void OnFrameBegin();
 
+    const VKDescriptorPoolStats& GetStats() const;
+
 private:
+    bool TryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout& set_layout, VkDescriptorSet& descriptor_set);
     void ResizeHeap(const std::map<VkDescriptorType, size_t>& count);
 
-private:
     VKContext& m_context;
+    std::vector<VkDescriptorPool> m_pools;
+    size_t m_pool_index = 0;
+    uint32_t m_chunk_size = 256;
+    VKDescriptorPoolStats m_stats;
+    // Parallel recording threads allocate from the pool of the same frame
+    std::mutex m_mutex;
 };
@@ -0,0 +1,230 @@
+#include "Context/VKMemoryAllocator.h"
+#include "Context/VKContext.h"
+#include <Utilities/VKUtility.h>
+#include <algorithm>
+#include <stdexcept>
+
+VKMemoryBlock::VKMemoryBlock(VKContext& context, uint32_t memory_type_index, bool host_visible)
+    : m_context(context)
+    , m_free_lists(GetMaxOrder() + 1)
+{
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = kBlockSize;
+    alloc_info.memoryTypeIndex = memory_type_index;
+    if (vkAllocateMemory(m_context.m_device, &alloc_info, nullptr, &m_memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory block!");
+    }
+    if (host_visible)
+        ASSERT_SUCCEEDED(vkMapMemory(m_context.m_device, m_memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&m_mapped)));
+
+    m_free_lists[GetMaxOrder()].insert(0);
+}
+
+VKMemoryBlock::~VKMemoryBlock()
+{
+    if (m_mapped)
+        vkUnmapMemory(m_context.m_device, m_memory);
+    vkFreeMemory(m_context.m_device, m_memory, nullptr);
+}
+
+uint32_t VKMemoryBlock::GetOrder(VkDeviceSize size)
+{
+    uint32_t order = 0;
+    while ((kMinAllocationSize << order) < size)
+        ++order;
+    return order;
+}
+
+uint32_t VKMemoryBlock::GetMaxOrder()
+{
+    return GetOrder(kBlockSize);
+}
+
+bool VKMemoryBlock::Allocate(uint32_t order, VkDeviceSize& offset)
+{
+    uint32_t cur_order = order;
+    while (cur_order < m_free_lists.size() && m_free_lists[cur_order].empty())
+        ++cur_order;
+    if (cur_order == m_free_lists.size())
+        return false;
+
+    offset = *m_free_lists[cur_order].begin();
+    m_free_lists[cur_order].erase(m_free_lists[cur_order].begin());
+
+    // Split the found range, the upper halves become free buddies of the lower orders
+    while (cur_order > order)
+    {
+        --cur_order;
+        m_free_lists[cur_order].insert(offset + (kMinAllocationSize << cur_order));
+    }
+
+    m_used += kMinAllocationSize << order;
+    return true;
+}
+
+void VKMemoryBlock::Free(VkDeviceSize offset, uint32_t order)
+{
+    m_used -= kMinAllocationSize << order;
+    while (order < GetMaxOrder())
+    {
+        VkDeviceSize buddy = offset ^ (kMinAllocationSize << order);
+        auto it = m_free_lists[order].find(buddy);
+        if (it == m_free_lists[order].end())
+            break;
+        m_free_lists[order].erase(it);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    m_free_lists[order].insert(offset);
+}
+
+VKMemoryAllocator::VKMemoryAllocator(VKContext& context)
+    : m_context(context)
+{
+    vkGetPhysicalDeviceMemoryProperties(m_context.m_physical_device, &m_memory_properties);
+}
+
+uint32_t VKMemoryAllocator::FindMemoryType(uint32_t type_bits, VKHeapType heap_type) const
+{
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    switch (heap_type)
+    {
+    case VKHeapType::kDeviceLocal:
+        required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        break;
+    case VKHeapType::kUpload:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        break;
+    case VKHeapType::kReadback:
+        required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    }
+
+    for (VkMemoryPropertyFlags flags : { required | preferred, required })
+    {
+        for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; ++i)
+        {
+            if ((type_bits & (1 << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & flags) == flags)
+                return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VKMemoryAllocation VKMemoryAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memory_type_index, bool host_visible)
+{
+    VKMemoryAllocation allocation = {};
+    allocation.size = size;
+
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = memory_type_index;
+    if (vkAllocateMemory(m_context.m_device, &alloc_info, nullptr, &allocation.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory!");
+    }
+    if (host_visible)
+        ASSERT_SUCCEEDED(vkMapMemory(m_context.m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&allocation.mapped)));
+
+    ++m_stats.dedicated_count;
+    m_stats.reserved_bytes += size;
+    return allocation;
+}
+
+VKMemoryAllocation VKMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VKHeapType heap_type, bool linear)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t memory_type_index = FindMemoryType(requirements.memoryTypeBits, heap_type);
+    bool host_visible = m_memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    // Buddy ranges are aligned to their own size, so rounding up to the alignment is enough
+    VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+    uint32_t order = VKMemoryBlock::GetOrder(size);
+
+    VKMemoryAllocation allocation = {};
+    if (order > VKMemoryBlock::GetMaxOrder())
+    {
+        allocation = AllocateDedicated(requirements.size, memory_type_index, host_visible);
+    }
+    else
+    {
+        auto& blocks = m_blocks[{ memory_type_index, linear }];
+        VKMemoryBlock* block = nullptr;
+        for (auto& cur_block : blocks)
+        {
+            if (cur_block->Allocate(order, allocation.offset))
+            {
+                block = cur_block.get();
+                break;
+            }
+        }
+        if (!block)
+        {
+            blocks.emplace_back(std::make_unique<VKMemoryBlock>(m_context, memory_type_index, host_visible));
+            block = blocks.back().get();
+            block->Allocate(order, allocation.offset);
+            ++m_stats.block_count;
+            m_stats.reserved_bytes += VKMemoryBlock::kBlockSize;
+        }
+
+        allocation.memory = block->GetMemory();
+        allocation.size = VKMemoryBlock::kMinAllocationSize << order;
+        allocation.block = block;
+        allocation.order = order;
+        if (block->GetMappedData())
+            allocation.mapped = block->GetMappedData() + allocation.offset;
+    }
+
+    ++m_stats.allocation_count;
+    m_stats.used_bytes += allocation.size;
+    return allocation;
+}
+
+void VKMemoryAllocator::Free(const VKMemoryAllocation& allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    --m_stats.allocation_count;
+    m_stats.used_bytes -= allocation.size;
+
+    if (!allocation.block)
+    {
+        if (allocation.mapped)
+            vkUnmapMemory(m_context.m_device, allocation.memory);
+        vkFreeMemory(m_context.m_device, allocation.memory, nullptr);
+        --m_stats.dedicated_count;
+        m_stats.reserved_bytes -= allocation.size;
+        return;
+    }
+
+    allocation.block->Free(allocation.offset, allocation.order);
+    if (allocation.block->GetUsedSize() != 0)
+        return;
+
+    // Keep one empty block per memory type to avoid reallocating it on the next request
+    for (auto& blocks : m_blocks)
+    {
+        auto it = std::find_if(blocks.second.begin(), blocks.second.end(), [&](const std::unique_ptr<VKMemoryBlock>& block) {
+            return block.get() == allocation.block;
+        });
+        if (it == blocks.second.end())
+            continue;
+        if (blocks.second.size() > 1)
+        {
+            blocks.second.erase(it);
+            --m_stats.block_count;
+            m_stats.reserved_bytes -= VKMemoryBlock::kBlockSize;
+        }
+        break;
+    }
+}
+
+const VKMemoryStats& VKMemoryAllocator::GetStats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VKContext;
+
+enum class VKHeapType
+{
+    kDeviceLocal,
+    kUpload,
+    kReadback,
+};
+
+class VKMemoryBlock;
+
+struct VKMemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint8_t* mapped = nullptr;
+
+    VKMemoryBlock* block = nullptr;
+    uint32_t order = 0;
+};
+
+struct VKMemoryStats
+{
+    size_t block_count = 0;
+    size_t dedicated_count = 0;
+    size_t allocation_count = 0;
+    VkDeviceSize reserved_bytes = 0;
+    VkDeviceSize used_bytes = 0;
+};
+
+// Buddy allocator over a single VkDeviceMemory, host visible blocks stay mapped for their whole lifetime
+class VKMemoryBlock
+{
+public:
+    static constexpr VkDeviceSize kMinAllocationSize = 256;
+    static constexpr VkDeviceSize kBlockSize = 64 * 1024 * 1024;
+
+    VKMemoryBlock(VKContext& context, uint32_t memory_type_index, bool host_visible);
+    ~VKMemoryBlock();
+
+    bool Allocate(uint32_t order, VkDeviceSize& offset);
+    void Free(VkDeviceSize offset, uint32_t order);
+
+    static uint32_t GetOrder(VkDeviceSize size);
+    static uint32_t GetMaxOrder();
+
+    VkDeviceMemory GetMemory() const { return m_memory; }
+    uint8_t* GetMappedData() const { return m_mapped; }
+    VkDeviceSize GetUsedSize() const { return m_used; }
+
+private:
+    VKContext& m_context;
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    uint8_t* m_mapped = nullptr;
+    VkDeviceSize m_used = 0;
+    std::vector<std::set<VkDeviceSize>> m_free_lists;
+};
+
+class VKMemoryAllocator
+{
+public:
+    VKMemoryAllocator(VKContext& context);
+
+    // Linear (buffers) and optimal (images) resources are placed into different blocks
+    // so that bufferImageGranularity never has to be taken into account
+    VKMemoryAllocation Allocate(const VkMemoryRequirements& requirements, VKHeapType heap_type, bool linear);
+    void Free(const VKMemoryAllocation& allocation);
+
+    const VKMemoryStats& GetStats() const;
+
+private:
+    uint32_t FindMemoryType(uint32_t type_bits, VKHeapType heap_type) const;
+    VKMemoryAllocation AllocateDedicated(VkDeviceSize size, uint32_t memory_type_index, bool host_visible);
+
+    VKContext& m_context;
+    VkPhysicalDeviceMemoryProperties m_memory_properties = {};
+    std::map<std::pair<uint32_t, bool>, std::vector<std::unique_ptr<VKMemoryBlock>>> m_blocks;
+    VKMemoryStats m_stats;
+    std::mutex m_mutex;
+};
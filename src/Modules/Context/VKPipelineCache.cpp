@@ -0,0 +1,119 @@
+#include "Context/VKPipelineCache.h"
+#include "Context/VKContext.h"
+#include <Utilities/FileUtility.h>
+#include <Utilities/VKUtility.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+VKPipelineCache::VKPipelineCache(VKContext& context)
+    : m_context(context)
+{
+    std::vector<char> data = Load();
+
+    VkPipelineCacheCreateInfo cache_info = {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.data();
+    ASSERT_SUCCEEDED(vkCreatePipelineCache(m_context.m_device, &cache_info, nullptr, &m_pipeline_cache));
+}
+
+VkPipeline VKPipelineCache::Find(const VKPipelineKey& key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pipelines.find(key.GetData());
+    if (it == m_pipelines.end())
+        return VK_NULL_HANDLE;
+    return it->second;
+}
+
+VkPipeline VKPipelineCache::CreateGraphicsPipeline(const VKPipelineKey& key, const VkGraphicsPipelineCreateInfo& create_info)
+{
+    // Another recording thread may have created the same pipeline since the caller's Find
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pipelines.find(key.GetData());
+    if (it != m_pipelines.end())
+        return it->second;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_context.m_device, m_pipeline_cache, 1, &create_info, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to vkCreateGraphicsPipelines");
+    }
+    m_pipelines[key.GetData()] = pipeline;
+    return pipeline;
+}
+
+VkPipeline VKPipelineCache::CreateComputePipeline(const VKPipelineKey& key, const VkComputePipelineCreateInfo& create_info)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pipelines.find(key.GetData());
+    if (it != m_pipelines.end())
+        return it->second;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(m_context.m_device, m_pipeline_cache, 1, &create_info, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to vkCreateComputePipelines");
+    }
+    m_pipelines[key.GetData()] = pipeline;
+    return pipeline;
+}
+
+void VKPipelineCache::Save()
+{
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_context.m_device, m_pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_context.m_device, m_pipeline_cache, &size, data.data()) != VK_SUCCESS)
+        return;
+
+    // Write to a temporary file first so that an interrupted run never leaves a truncated cache behind
+    std::string path = GetCachePath();
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), size))
+            return;
+    }
+    std::remove(path.c_str());
+    std::rename(tmp_path.c_str(), path.c_str());
+}
+
+std::vector<char> VKPipelineCache::Load() const
+{
+    std::ifstream file(GetCachePath(), std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!IsCompatible(data))
+        return {};
+    return data;
+}
+
+bool VKPipelineCache::IsCompatible(const std::vector<char>& data) const
+{
+    struct Header
+    {
+        uint32_t header_size;
+        uint32_t header_version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint8_t uuid[VK_UUID_SIZE];
+    } header = {};
+
+    if (data.size() < sizeof(header))
+        return false;
+    memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties device_properties = {};
+    vkGetPhysicalDeviceProperties(m_context.m_physical_device, &device_properties);
+
+    return header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendor_id == device_properties.vendorID &&
+           header.device_id == device_properties.deviceID &&
+           memcmp(header.uuid, device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+std::string VKPipelineCache::GetCachePath() const
+{
+    return GetExecutableDir() + "/vk_pipeline_cache.bin";
+}
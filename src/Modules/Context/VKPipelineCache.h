@@ -0,0 +1,60 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+class VKContext;
+
+// The exact state a pipeline is created from, compared in full on lookup so that colliding hashes never share a pipeline.
+// Handles are part of the state. Shader modules and pipeline layouts of a relinked program are destroyed and their
+// handles may be reused, so keys of programs also carry the link they were created by.
+class VKPipelineKey
+{
+public:
+    template<typename T>
+    void Add(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "pipeline state is compared bytewise");
+        m_data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void Add(const std::string& str)
+    {
+        Add(str.size());
+        m_data.append(str);
+    }
+
+    const std::string& GetData() const
+    {
+        return m_data;
+    }
+
+private:
+    std::string m_data;
+};
+
+class VKPipelineCache
+{
+public:
+    VKPipelineCache(VKContext& context);
+
+    VkPipeline Find(const VKPipelineKey& key) const;
+    VkPipeline CreateGraphicsPipeline(const VKPipelineKey& key, const VkGraphicsPipelineCreateInfo& create_info);
+    VkPipeline CreateComputePipeline(const VKPipelineKey& key, const VkComputePipelineCreateInfo& create_info);
+
+    void Save();
+
+private:
+    std::vector<char> Load() const;
+    bool IsCompatible(const std::vector<char>& data) const;
+    std::string GetCachePath() const;
+
+    VKContext& m_context;
+    VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+    std::unordered_map<std::string, VkPipeline> m_pipelines;
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,150 @@
+#include "Context/VKRenderPassCache.h"
+#include "Context/VKContext.h"
+#include <stdexcept>
+
+VKRenderPassCache::VKRenderPassCache(VKContext& context)
+    : m_context(context)
+{
+}
+
+VKRenderPassCache::~VKRenderPassCache()
+{
+    for (auto& framebuffer : m_framebuffers)
+        vkDestroyFramebuffer(m_context.m_device, framebuffer.second, nullptr);
+    for (auto& render_pass : m_render_passes)
+        vkDestroyRenderPass(m_context.m_device, render_pass.second, nullptr);
+}
+
+VkRenderPass VKRenderPassCache::GetRenderPass(const RenderPassDesc& desc)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_render_passes.find(desc);
+    if (it == m_render_passes.end())
+        it = m_render_passes.emplace(desc, CreateRenderPass(desc)).first;
+    return it->second;
+}
+
+VkFramebuffer VKRenderPassCache::GetFramebuffer(const FramebufferDesc& desc, VkRenderPass render_pass)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_framebuffers.find(desc);
+    if (it != m_framebuffers.end())
+        return it->second;
+
+    VkFramebufferCreateInfo framebuffer_info = {};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = render_pass;
+    framebuffer_info.attachmentCount = desc.views.size();
+    framebuffer_info.pAttachments = desc.views.data();
+    framebuffer_info.width = desc.width;
+    framebuffer_info.height = desc.height;
+    framebuffer_info.layers = desc.layers;
+
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    if (vkCreateFramebuffer(m_context.m_device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create framebuffer!");
+    }
+    m_framebuffers.emplace(desc, framebuffer);
+    return framebuffer;
+}
+
+void VKRenderPassCache::OnImageViewDelete(VkImageView view)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();)
+    {
+        if (std::find(it->first.views.begin(), it->first.views.end(), view) != it->first.views.end())
+        {
+            vkDestroyFramebuffer(m_context.m_device, it->second, nullptr);
+            it = m_framebuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+VkRenderPass VKRenderPassCache::CreateRenderPass(const RenderPassDesc& desc)
+{
+    std::vector<VkAttachmentDescription> attachment_descriptions;
+    std::vector<VkAttachmentReference> attachment_references;
+    for (const auto& color : desc.colors)
+    {
+        attachment_descriptions.emplace_back();
+        VkAttachmentDescription& description = attachment_descriptions.back();
+        description.format = color.format;
+        description.samples = color.samples;
+        description.loadOp = color.load_op;
+        description.storeOp = color.store_op;
+        description.stencilLoadOp = color.stencil_load_op;
+        description.stencilStoreOp = color.stencil_store_op;
+        description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        attachment_references.emplace_back();
+        VkAttachmentReference& reference = attachment_references.back();
+        reference.attachment = attachment_references.size() - 1;
+        reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    VkAttachmentReference depth_reference = {};
+    if (desc.has_depth)
+    {
+        attachment_descriptions.emplace_back();
+        VkAttachmentDescription& description = attachment_descriptions.back();
+        description.format = desc.depth.format;
+        description.samples = desc.depth.samples;
+        description.loadOp = desc.depth.load_op;
+        description.storeOp = desc.depth.store_op;
+        description.stencilLoadOp = desc.depth.stencil_load_op;
+        description.stencilStoreOp = desc.depth.stencil_store_op;
+        description.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        description.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        depth_reference.attachment = attachment_descriptions.size() - 1;
+        depth_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    }
+
+    VkSubpassDescription sub_pass = {};
+    sub_pass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    sub_pass.colorAttachmentCount = attachment_references.size();
+    sub_pass.pColorAttachments = attachment_references.data();
+    if (desc.has_depth)
+        sub_pass.pDepthStencilAttachment = &depth_reference;
+
+    // Layout transitions are recorded as barriers outside of the pass, so the only hazard left is
+    // a previous pass writing the same attachments in the same layout
+    VkPipelineStageFlags attachment_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkAccessFlags attachment_write_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkAccessFlags attachment_access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if (desc.has_depth)
+    {
+        attachment_stages |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        attachment_write_access |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        attachment_access |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
+
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = attachment_stages;
+    dependency.dstStageMask = attachment_stages;
+    dependency.srcAccessMask = attachment_write_access;
+    dependency.dstAccessMask = attachment_access;
+
+    VkRenderPassCreateInfo render_pass_info = {};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = attachment_descriptions.size();
+    render_pass_info.pAttachments = attachment_descriptions.data();
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &sub_pass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    if (vkCreateRenderPass(m_context.m_device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to vkCreateRenderPass");
+    }
+    return render_pass;
+}
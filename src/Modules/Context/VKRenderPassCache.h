@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VKContext;
+
+struct RenderPassDesc
+{
+    struct Attachment
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+        VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+        VkAttachmentLoadOp stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkAttachmentStoreOp stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+    private:
+        auto MakeTie() const
+        {
+            return std::tie(format, samples, load_op, store_op, stencil_load_op, stencil_store_op);
+        }
+
+    public:
+        bool operator< (const Attachment& oth) const
+        {
+            return MakeTie() < oth.MakeTie();
+        }
+    };
+
+    std::vector<Attachment> colors;
+    bool has_depth = false;
+    Attachment depth;
+
+private:
+    auto MakeTie() const
+    {
+        return std::tie(colors, has_depth, depth);
+    }
+
+public:
+    bool operator< (const RenderPassDesc& oth) const
+    {
+        return MakeTie() < oth.MakeTie();
+    }
+};
+
+struct FramebufferDesc
+{
+    std::vector<VkImageView> views;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t layers = 1;
+
+private:
+    auto MakeTie() const
+    {
+        return std::tie(views, width, height, layers);
+    }
+
+public:
+    bool operator< (const FramebufferDesc& oth) const
+    {
+        return MakeTie() < oth.MakeTie();
+    }
+};
+
+class VKRenderPassCache
+{
+public:
+    VKRenderPassCache(VKContext& context);
+    ~VKRenderPassCache();
+
+    VkRenderPass GetRenderPass(const RenderPassDesc& desc);
+    // Framebuffers are keyed only by their views, so one framebuffer serves every
+    // render pass that is compatible with it regardless of load/store ops
+    VkFramebuffer GetFramebuffer(const FramebufferDesc& desc, VkRenderPass render_pass);
+    void OnImageViewDelete(VkImageView view);
+
+private:
+    VkRenderPass CreateRenderPass(const RenderPassDesc& desc);
+
+    VKContext& m_context;
+    std::map<RenderPassDesc, VkRenderPass> m_render_passes;
+    std::map<FramebufferDesc, VkFramebuffer> m_framebuffers;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,212 @@
+#include "Context/VKUploadManager.h"
+#include "Context/VKContext.h"
+#include <algorithm>
+#include <cstring>
+
+VKUploadManager::VKUploadManager(VKContext& context)
+    : m_context(context)
+{
+    m_frame_end.fill(kInvalidOffset);
+
+    VkPhysicalDeviceProperties device_properties = {};
+    vkGetPhysicalDeviceProperties(m_context.m_physical_device, &device_properties);
+    m_alignment = std::max<VkDeviceSize>(m_alignment, device_properties.limits.optimalBufferCopyOffsetAlignment);
+
+    Resize(kInitialRingSize);
+}
+
+void VKUploadManager::Resize(VkDeviceSize size)
+{
+    // The previous ring is released through the deletion queue, so copies already recorded from it stay valid
+    m_size = size;
+    m_ring = std::static_pointer_cast<VKResource>(m_context.CreateBuffer(0, static_cast<uint32_t>(m_size), 0));
+    m_head = 0;
+    m_tail = 0;
+    m_frame_end.fill(kInvalidOffset);
+}
+
+bool VKUploadManager::TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    offset = (m_head + alignment - 1) / alignment * alignment;
+    if (m_head >= m_tail)
+    {
+        if (offset + size <= m_size)
+            return true;
+        // Wrap around, the head must never catch up with the tail or the ring would look empty
+        offset = 0;
+        return size < m_tail;
+    }
+    return offset + size < m_tail;
+}
+
+VKUploadManager::Staging VKUploadManager::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    VkDeviceSize offset = 0;
+    if (!TryAllocate(size, alignment, offset))
+    {
+        // Asset loading may upload far more than a frame does, the ring stays capped for the rest of the process
+        VkDeviceSize new_size = std::min(std::max(m_size * 2, size * 2), kMaxRingSize);
+        if (new_size <= m_size || size * 2 > new_size)
+        {
+            auto buffer = std::static_pointer_cast<VKResource>(m_context.CreateBuffer(0, static_cast<uint32_t>(size), 0));
+            m_temporary_buffers.push_back(buffer);
+            return { buffer->buffer.res, 0, buffer->buffer.memory.mapped };
+        }
+        Flush();
+        Resize(new_size);
+        offset = 0;
+    }
+    m_head = offset + size;
+    return { m_ring->buffer.res, offset, m_ring->buffer.memory.mapped + offset };
+}
+
+void VKUploadManager::UpdateBuffer(VKResource& res, uint64_t dst_offset, const void* data, size_t size)
+{
+    if (m_pending_dst.count(reinterpret_cast<uint64_t>(res.buffer.res)))
+        Flush();
+
+    Staging staging = Allocate(size, m_alignment);
+    memcpy(staging.mapped, data, size);
+
+    BufferCopy copy = {};
+    copy.src = staging.buffer;
+    copy.dst = res.buffer.res;
+    copy.region.srcOffset = staging.offset;
+    copy.region.dstOffset = dst_offset;
+    copy.region.size = size;
+    m_buffer_copies.push_back(copy);
+    m_pending_dst.insert(reinterpret_cast<uint64_t>(res.buffer.res));
+}
+
+void VKUploadManager::UpdateImage(VKResource& res, uint32_t subresource, const void* data, size_t size)
+{
+    if (m_pending_dst.count(reinterpret_cast<uint64_t>(res.image.res)))
+        Flush();
+
+    Staging staging = Allocate(size, m_alignment);
+    memcpy(staging.mapped, data, size);
+
+    ImageCopy copy = {};
+    copy.src = staging.buffer;
+    copy.dst = res.image.res;
+    copy.region.bufferOffset = staging.offset;
+    copy.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.region.imageSubresource.mipLevel = subresource;
+    copy.region.imageSubresource.baseArrayLayer = 0;
+    copy.region.imageSubresource.layerCount = 1;
+    copy.region.imageExtent.width = std::max(1u, static_cast<uint32_t>(res.image.size.width >> subresource));
+    copy.region.imageExtent.height = std::max(1u, static_cast<uint32_t>(res.image.size.height >> subresource));
+    copy.region.imageExtent.depth = 1;
+    m_image_copies.push_back(copy);
+    m_pending_dst.insert(reinterpret_cast<uint64_t>(res.image.res));
+
+    // The subresource ends up in the shader read layout once the batch is flushed
+    res.image.SetLayout(subresource, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+bool VKUploadManager::HasPendingCopies() const
+{
+    return !m_buffer_copies.empty() || !m_image_copies.empty();
+}
+
+void VKUploadManager::Flush()
+{
+    if (!HasPendingCopies())
+        return;
+
+    VkCommandBuffer cmd = m_context.GetCommandBuffer();
+    // Layout transitions queued before the copies were recorded have to execute first
+    m_context.FlushBarriers();
+    m_context.EndRenderPass();
+
+    std::vector<VkImageMemoryBarrier> image_barriers;
+    for (auto& copy : m_image_copies)
+    {
+        image_barriers.emplace_back();
+        VkImageMemoryBarrier& barrier = image_barriers.back();
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.dst;
+        barrier.subresourceRange.aspectMask = copy.region.imageSubresource.aspectMask;
+        barrier.subresourceRange.baseMipLevel = copy.region.imageSubresource.mipLevel;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = copy.region.imageSubresource.baseArrayLayer;
+        barrier.subresourceRange.layerCount = copy.region.imageSubresource.layerCount;
+    }
+
+    // Buffers may still be read by earlier commands of this frame
+    VkPipelineStageFlags read_stages =
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT |
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    read_stages = m_context.GetSupportedStages(read_stages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    VkMemoryBarrier memory_barrier = {};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = 0;
+    memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        cmd,
+        read_stages,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1, &memory_barrier,
+        0, nullptr,
+        image_barriers.size(), image_barriers.data());
+
+    for (auto& copy : m_buffer_copies)
+        vkCmdCopyBuffer(cmd, copy.src, copy.dst, 1, &copy.region);
+    for (auto& copy : m_image_copies)
+        vkCmdCopyBufferToImage(cmd, copy.src, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+
+    for (auto& barrier : image_barriers)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    if (read_stages & VK_PIPELINE_STAGE_VERTEX_INPUT_BIT)
+        memory_barrier.dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    if (read_stages & VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
+        memory_barrier.dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        read_stages,
+        0,
+        1, &memory_barrier,
+        0, nullptr,
+        image_barriers.size(), image_barriers.data());
+
+    m_buffer_copies.clear();
+    m_image_copies.clear();
+    m_pending_dst.clear();
+    // Destroyed once the frame recording the copies is retired
+    m_temporary_buffers.clear();
+}
+
+void VKUploadManager::OnFrameBegin(size_t frame_index)
+{
+    // The fence of this frame has been signaled, everything it staged may be overwritten
+    if (m_frame_end[frame_index] != kInvalidOffset)
+        m_tail = m_frame_end[frame_index];
+    m_frame_end[frame_index] = kInvalidOffset;
+}
+
+void VKUploadManager::OnFrameEnd(size_t frame_index)
+{
+    m_frame_end[frame_index] = m_head;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <set>
+#include <vector>
+#include <Context/Context.h>
+#include <Resource/VKResource.h>
+
+class VKContext;
+
+// Streams UpdateSubresource data through a persistently mapped ring buffer.
+// Copies are recorded lazily and flushed as one batch with a single barrier group on each side.
+// The ring grows up to kMaxRingSize, uploads not fitting into it use a staging buffer of their own,
+// released after the flush through the deletion queue.
+class VKUploadManager
+{
+public:
+    VKUploadManager(VKContext& context);
+
+    void UpdateBuffer(VKResource& res, uint64_t dst_offset, const void* data, size_t size);
+    void UpdateImage(VKResource& res, uint32_t subresource, const void* data, size_t size);
+
+    bool HasPendingCopies() const;
+    void Flush();
+
+    void OnFrameBegin(size_t frame_index);
+    void OnFrameEnd(size_t frame_index);
+
+private:
+    struct Staging
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        uint8_t* mapped;
+    };
+
+    Staging Allocate(VkDeviceSize size, VkDeviceSize alignment);
+    bool TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void Resize(VkDeviceSize size);
+
+    struct BufferCopy
+    {
+        VkBuffer src;
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy
+    {
+        VkBuffer src;
+        VkImage dst;
+        VkBufferImageCopy region;
+    };
+
+    static constexpr VkDeviceSize kInvalidOffset = ~0ull;
+    static constexpr VkDeviceSize kInitialRingSize = 32 * 1024 * 1024;
+    static constexpr VkDeviceSize kMaxRingSize = 128 * 1024 * 1024;
+
+    VKContext& m_context;
+    VKResource::Ptr m_ring;
+    VkDeviceSize m_size = 0;
+    VkDeviceSize m_head = 0;
+    VkDeviceSize m_tail = 0;
+    VkDeviceSize m_alignment = 16;
+    std::array<VkDeviceSize, Context::FrameCount> m_frame_end;
+    std::vector<VKResource::Ptr> m_temporary_buffers;
+
+    std::vector<BufferCopy> m_buffer_copies;
+    std::vector<ImageCopy> m_image_copies;
+    std::set<uint64_t> m_pending_dst;
+};
@@ -0,0 +1,58 @@
+#include "Context/VKViewCache.h"
+#include "Context/VKContext.h"
+#include <Utilities/VKUtility.h>
+
+ImageViewDesc::ImageViewDesc(const VkImageViewCreateInfo& view_info)
+    : image(view_info.image)
+    , view_type(view_info.viewType)
+    , format(view_info.format)
+    , aspect_mask(view_info.subresourceRange.aspectMask)
+    , base_mip_level(view_info.subresourceRange.baseMipLevel)
+    , level_count(view_info.subresourceRange.levelCount)
+    , base_array_layer(view_info.subresourceRange.baseArrayLayer)
+    , layer_count(view_info.subresourceRange.layerCount)
+{
+}
+
+VKViewCache::VKViewCache(VKContext& context)
+    : m_context(context)
+{
+}
+
+VKViewCache::~VKViewCache()
+{
+    for (auto& image_view : m_image_views)
+        vkDestroyImageView(m_context.m_device, image_view.second, nullptr);
+}
+
+VkImageView VKViewCache::GetImageView(const VkImageViewCreateInfo& view_info)
+{
+    ImageViewDesc desc(view_info);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_image_views.find(desc);
+    if (it != m_image_views.end())
+        return it->second;
+
+    VkImageView image_view = VK_NULL_HANDLE;
+    ASSERT_SUCCEEDED(vkCreateImageView(m_context.m_device, &view_info, nullptr, &image_view));
+    m_image_views.emplace(desc, image_view);
+    return image_view;
+}
+
+void VKViewCache::OnImageDelete(VkImage image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The image is the first member of the key, so its views are a contiguous range
+    ImageViewDesc first;
+    first.image = image;
+    first.view_type = static_cast<VkImageViewType>(0);
+    first.level_count = 0;
+    first.layer_count = 0;
+    auto it = m_image_views.lower_bound(first);
+    while (it != m_image_views.end() && it->first.image == image)
+    {
+        m_context.GetRenderPassCache().OnImageViewDelete(it->second);
+        vkDestroyImageView(m_context.m_device, it->second, nullptr);
+        it = m_image_views.erase(it);
+    }
+}
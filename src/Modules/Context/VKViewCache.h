@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vulkan/vulkan.h>
+
+class VKContext;
+
+struct ImageViewDesc
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageAspectFlags aspect_mask = 0;
+    uint32_t base_mip_level = 0;
+    uint32_t level_count = 1;
+    uint32_t base_array_layer = 0;
+    uint32_t layer_count = 1;
+
+    ImageViewDesc() = default;
+    ImageViewDesc(const VkImageViewCreateInfo& view_info);
+
+private:
+    auto MakeTie() const
+    {
+        return std::tie(image, view_type, format, aspect_mask, base_mip_level, level_count, base_array_layer, layer_count);
+    }
+
+public:
+    bool operator< (const ImageViewDesc& oth) const
+    {
+        return MakeTie() < oth.MakeTie();
+    }
+};
+
+// Image views are keyed by their contents rather than by the program binding them,
+// so every program sampling or rendering to the same subresources gets the same VkImageView
+class VKViewCache
+{
+public:
+    VKViewCache(VKContext& context);
+    ~VKViewCache();
+
+    VkImageView GetImageView(const VkImageViewCreateInfo& view_info);
+    // Must be called once the GPU no longer uses the image, before it is destroyed
+    void OnImageDelete(VkImage image);
+
+private:
+    VKContext& m_context;
+    std::map<ImageViewDesc, VkImageView> m_image_views;
+    std::mutex m_mutex;
+};
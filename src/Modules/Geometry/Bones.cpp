@@ -53,17 +53,18 @@ Resource::Ptr Bones::GetBonesInfo(Context& context)
     if (!bones_info_srv)
         bones_info_srv = context.CreateBuffer(BindFlag::kSrv, static_cast<uint32_t>(bone_info.size() * sizeof(BoneInfo)), sizeof(BoneInfo));
     if (!bone_info.empty())
-        context.UpdateSubresource(bones_info_srv, 0, bone_info.data(), 0, 0);
+        context.UpdateBuffer(bones_info_srv, 0, bone_info.data(), bone_info.size() * sizeof(BoneInfo));
     return bones_info_srv;
 }
 
 Resource::Ptr Bones::GetBone(Context& context)
 {
-    if (!bone_srv)
-        bone_srv = context.CreateBuffer(BindFlag::kSrv, static_cast<uint32_t>(bone.size() * sizeof(glm::mat4)), sizeof(glm::mat4));
+    auto& buffer = bone_srv[context.GetFrameIndex()];
+    if (!buffer)
+        buffer = context.CreateBuffer(BindFlag::kSrv | BindFlag::kCpuWrite, static_cast<uint32_t>(bone.size() * sizeof(glm::mat4)), sizeof(glm::mat4));
     if (!bone.empty())
-        context.UpdateSubresource(bone_srv, 0, bone.data(), 0, 0);
-    return bone_srv;
+        context.UpdateBuffer(buffer, 0, bone.data(), bone.size() * sizeof(glm::mat4));
+    return buffer;
 }
 
 bool Bones::UpdateAnimation(float time_in_seconds)
@@ -2,8 +2,10 @@
 
 #include "Geometry/Mesh.h"
 #include <Resource/Resource.h>
+#include <Context/Context.h>
 #include <assimp/scene.h>
 #include <vector>
+#include <array>
 #include <glm/glm.hpp>
 
 class Bones
@@ -38,7 +40,8 @@ private:
     std::vector<glm::mat4> bone;
 
     Resource::Ptr bones_info_srv;
-    Resource::Ptr bone_srv;
+    // Rewritten every frame through a CPU-visible buffer, one per frame in flight
+    std::array<Resource::Ptr, Context::FrameCount> bone_srv;
     std::map<std::string, uint32_t> bone_mapping;
     std::vector<glm::mat4> bone_offset;
     const aiScene* m_scene = nullptr;
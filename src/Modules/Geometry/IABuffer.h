@@ -60,6 +60,54 @@ private:
     size_t m_count;
 };
 
+// Stream for vertex inputs with an INSTANCE_ semantic, one element per instance of DrawIndexedInstanced
+class IAInstanceBuffer
+{
+public:
+    template<typename T>
+    IAInstanceBuffer(Context& context, const std::vector<T>& v)
+        : m_context(context)
+    {
+        Update(v);
+    }
+
+    template<typename T>
+    void Update(const std::vector<T>& v)
+    {
+        size_t size = v.size() * sizeof(T);
+        if (!m_buffer || m_size != size)
+        {
+            m_size = size;
+            m_buffer = m_context.CreateBuffer(BindFlag::kVbv, static_cast<uint32_t>(m_size), sizeof(T));
+        }
+        m_count = static_cast<uint32_t>(v.size());
+        if (m_buffer)
+            m_context.UpdateSubresource(m_buffer, 0, v.data(), 0, 0);
+    }
+
+    void BindToSlot(uint32_t slot)
+    {
+        if (m_buffer)
+            m_context.IASetVertexBuffer(slot, m_buffer);
+    }
+
+    Resource::Ptr GetBuffer() const
+    {
+        return m_buffer;
+    }
+
+    uint32_t Count() const
+    {
+        return m_count;
+    }
+
+private:
+    Context& m_context;
+    Resource::Ptr m_buffer;
+    size_t m_size = 0;
+    uint32_t m_count = 0;
+};
+
 class IAIndexBuffer
 {
 public:
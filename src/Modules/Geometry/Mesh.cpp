@@ -91,6 +91,25 @@ IAMergedMesh::IAMergedMesh(Context & context, std::vector<IMesh>& meshes)
     , ranges(std::move(m_data->ranges))
 {
     m_data.reset();
+    SetInstanceCount(context, 1);
+}
+
+void IAMergedMesh::SetInstanceCount(Context& context, uint32_t instance_count)
+{
+    if (m_instance_count == instance_count)
+        return;
+    m_instance_count = instance_count;
+
+    std::vector<DrawIndexedIndirectCommand> commands;
+    for (auto& range : ranges)
+        commands.push_back({ range.index_count, instance_count, range.start_index_location, range.base_vertex_location, 0 });
+    // Zero-size buffers are invalid, DrawIndexedIndirect ignores a null one
+    if (commands.empty())
+        return;
+    if (!indirect_args)
+        indirect_args = context.CreateBuffer(BindFlag::kIndirect, static_cast<uint32_t>(commands.size() * sizeof(commands.front())), 0);
+    if (indirect_args)
+        context.UpdateSubresource(indirect_args, 0, commands.data(), 0, 0);
 }
 
 Material::Material(TextureCache& cache, const IMesh::Material& material, std::vector<TextureInfo>& textures)
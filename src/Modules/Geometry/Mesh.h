@@ -51,6 +51,7 @@ class IAMergedMesh
     std::unique_ptr<MergedMesh> m_data;
 public:
     IAMergedMesh(Context& context, std::vector<IMesh>& meshes);
+    void SetInstanceCount(Context& context, uint32_t instance_count);
 
     IAVertexBuffer positions;
     IAVertexBuffer normals;
@@ -60,6 +61,9 @@ public:
     IAVertexBuffer bones_count;
     IAIndexBuffer indices;
     std::vector<MeshRange> ranges;
+    // One DrawIndexedIndirectCommand per range, draws the whole mesh with Context::DrawIndexedIndirect
+    Resource::Ptr indirect_args;
 private:
     std::map<std::string, Resource::Ptr> m_tex_cache;
+    uint32_t m_instance_count = 0;
 };
@@ -4,6 +4,7 @@ Model::Model(Context& context, const std::string& file, uint32_t flags)
     : m_context(context)
     , m_model_loader(std::make_unique<ModelLoader>(file, (aiPostProcessSteps)flags, *this))
     , ia(context, meshes)
+    , instances(context, std::vector<glm::vec4>{ glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) })
     , m_cache(context)
 {
     for (auto & mesh : meshes)
@@ -24,6 +25,12 @@ Model::Model(Context& context, const std::string& file, uint32_t flags)
     }
 }
 
+void Model::SetInstances(const std::vector<glm::vec4>& offsets)
+{
+    instances.Update(offsets);
+    ia.SetInstanceCount(m_context, instances.Count());
+}
+
 void Model::AddMesh(const IMesh& mesh)
 {
     meshes.emplace_back(mesh);
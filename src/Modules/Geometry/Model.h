@@ -23,6 +23,8 @@ public:
     Model(Context& context, const std::string& file, uint32_t flags = ~0);
     virtual void AddMesh(const IMesh& mesh) override;
     virtual Bones& GetBones() override;
+    // Updates the instance stream together with the instance count of the indirect args
+    void SetInstances(const std::vector<glm::vec4>& offsets);
 
     std::vector<IMesh> meshes;
     Bones bones;
@@ -50,6 +52,9 @@ private:
 
 public:
     IAMergedMesh ia;
+    // Object space offset (xyz) and uniform scale (w) of every drawn copy, a single identity copy by default,
+    // changed through SetInstances
+    IAInstanceBuffer instances;
     TextureCache m_cache;
     std::vector<Material> materials;
     BoundBox bound_box;
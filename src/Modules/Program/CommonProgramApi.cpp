@@ -15,12 +15,13 @@ void CommonProgramApi::SetCBufferLayout(const BindKey& bind_key, BufferLayout& b
 
 void CommonProgramApi::SetBinding(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res)
 {
-    BoundResource bound_res = { res, CreateView(bind_key, view_desc, res) };
+    BoundResource bound_res = { res, CreateView(bind_key, view_desc, res), view_desc };
     auto it = m_bound_resources.find(bind_key);
     if (it == m_bound_resources.end())
         m_bound_resources.emplace(bind_key, bound_res);
     else
         it->second = bound_res;
+    OnSetBinding(bind_key, bound_res);
 }
 
 View::Ptr CommonProgramApi::FindView(ShaderType shader_type, ResourceType res_type, uint32_t slot)
@@ -34,7 +35,29 @@ View::Ptr CommonProgramApi::FindView(ShaderType shader_type, ResourceType res_ty
 
 void CommonProgramApi::Attach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res)
 {
+    // Views are created for the linked program
+    FinishCompilation();
+
+    m_context.CountAttach(BindResource(bind_key, view_desc, res));
+}
+
+bool CommonProgramApi::BindResource(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res)
+{
+    // Passes attach the same resources every frame and often every draw, the view lookup and the backend work are done only on changes
+    auto it = m_bound_resources.find(bind_key);
+    if (it != m_bound_resources.end() && it->second.res == res && it->second.view_desc == view_desc)
+    {
+        OnReattach(bind_key, view_desc, res);
+        return true;
+    }
+
     SetBinding(bind_key, view_desc, res);
+    DispatchAttach(bind_key, view_desc, res);
+    return false;
+}
+
+void CommonProgramApi::DispatchAttach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res)
+{
     switch (bind_key.res_type)
     {
     case ResourceType::kSrv:
@@ -77,6 +100,6 @@ void CommonProgramApi::UpdateCBuffers()
             m_context.UpdateSubresource(res, 0, buffer_layout.GetBuffer().data(), 0, 0);
         }
 
-        Attach(x.first, {}, res);
+        BindResource(x.first, {}, res);
     }
 }
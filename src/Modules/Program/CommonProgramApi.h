@@ -34,6 +34,13 @@ protected:
     virtual void OnAttachSampler(ShaderType type, const std::string& name, uint32_t slot, const Resource::Ptr& ires) = 0;
     virtual void OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const Resource::Ptr& ires) = 0;
     virtual void OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr& ires) = 0;
+    // Called instead of the OnAttach* above when the same resource and view are attached again,
+    // backends refresh here the state other programs may have changed in between, like resource layouts
+    virtual void OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res) {}
+    void DispatchAttach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res);
+    // Attach without counting it in the context attach stats, for buffers the program binds itself like cbuffers.
+    // Returns true when the resource and view were already bound
+    bool BindResource(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res);
 
     virtual View::Ptr CreateView(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res) = 0;
     View::Ptr FindView(ShaderType shader_type, ResourceType res_type, uint32_t slot);
@@ -45,8 +52,11 @@ protected:
     {
         Resource::Ptr res;
         View::Ptr view;
+        ViewDesc view_desc;
     };
     std::map<BindKey, BoundResource> m_bound_resources;
+    // Lets backends that keep descriptors of their own update just the binding that changed
+    virtual void OnSetBinding(const BindKey& bind_key, const BoundResource& bound_res) {}
     std::map<BindKey, std::reference_wrapper<BufferLayout>> m_cbv_layout;
     PerFrameData<std::map<BindKey, std::vector<Resource::Ptr>>> m_cbv_buffer;
     PerFrameData<std::map<BindKey, size_t>> m_cbv_offset;
@@ -32,6 +32,13 @@ void DX11ProgramApi::ClearBindings()
 
 void DX11ProgramApi::UseProgram()
 {
+    // There are no specialization constants in D3D, new values are compiled in as defines
+    if (SyncSpecializationConstants())
+    {
+        for (auto& stage : m_specialization_constants)
+            CompileShader(*stage.second.front().shader);
+    }
+
     m_context.device_context->VSSetShader(vshader.Get(), nullptr, 0);
     m_context.device_context->GSSetShader(gshader.Get(), nullptr, 0);
     m_context.device_context->DSSetShader(nullptr, nullptr, 0);
@@ -105,8 +112,16 @@ void DX11ProgramApi::CreateInputLayout()
         layout.SemanticName = param_desc.SemanticName;
         layout.SemanticIndex = param_desc.SemanticIndex;
         layout.InputSlot = i;
-        layout.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-        layout.InstanceDataStepRate = 0;
+        if (IsInstanceInput(i))
+        {
+            layout.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+            layout.InstanceDataStepRate = 1;
+        }
+        else
+        {
+            layout.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+            layout.InstanceDataStepRate = 0;
+        }
 
         if (param_desc.Mask == 1)
         {
@@ -154,26 +169,35 @@ void DX11ProgramApi::CreateInputLayout()
         m_blob_map[ShaderType::kVertex]->GetBufferSize(), &input_layout));
 }
 
-void DX11ProgramApi::CompileShader(const ShaderBase& shader)
+DX11ProgramApi::ShaderJob DX11ProgramApi::PrepareShader(const ShaderBase& shader)
 {
-    auto blob = DXCompile(shader);
-    m_blob_map[shader.type] = blob;
-    switch (shader.type)
+    ShaderDesc desc = GetSpecializedDesc(shader);
+    return [this, desc]() -> std::function<void()>
     {
-    case ShaderType::kVertex:
-        ASSERT_SUCCEEDED(m_context.device->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &vshader));
-        CreateInputLayout();
-        break;
-    case ShaderType::kPixel:
-        ASSERT_SUCCEEDED(m_context.device->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &pshader));
-        break;
-    case ShaderType::kCompute:
-        ASSERT_SUCCEEDED(m_context.device->CreateComputeShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &cshader));
-        break;
-    case ShaderType::kGeometry:
-        ASSERT_SUCCEEDED(m_context.device->CreateGeometryShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &gshader));
-        break;
-    }
+        ComPtr<ID3DBlob> blob = DXCompile(desc);
+        if (!blob)
+            return {};
+        return [this, desc, blob]
+        {
+            m_blob_map[desc.type] = blob;
+            switch (desc.type)
+            {
+            case ShaderType::kVertex:
+                ASSERT_SUCCEEDED(m_context.device->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &vshader));
+                CreateInputLayout();
+                break;
+            case ShaderType::kPixel:
+                ASSERT_SUCCEEDED(m_context.device->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &pshader));
+                break;
+            case ShaderType::kCompute:
+                ASSERT_SUCCEEDED(m_context.device->CreateComputeShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &cshader));
+                break;
+            case ShaderType::kGeometry:
+                ASSERT_SUCCEEDED(m_context.device->CreateGeometryShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &gshader));
+                break;
+            }
+        };
+    };
 }
 
 void DX11ProgramApi::AttachView(ShaderType type, uint32_t slot, ComPtr<ID3D11SamplerState>& sampler)
@@ -15,7 +15,7 @@ public:
     virtual void LinkProgram() override;
     void UseProgram();
     virtual void ApplyBindings() override;
-    virtual void CompileShader(const ShaderBase& shader) override;
+    virtual ShaderJob PrepareShader(const ShaderBase& shader) override;
 
     virtual void ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color) override;
     virtual void ClearDepthStencil(uint32_t ClearFlags, float Depth, uint8_t Stencil) override;
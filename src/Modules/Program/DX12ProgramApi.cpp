@@ -224,6 +224,13 @@ void DX12ProgramApi::LinkProgram()
 
 void DX12ProgramApi::UseProgram()
 {
+    // There are no specialization constants in D3D, new values are compiled in as defines
+    if (SyncSpecializationConstants())
+    {
+        for (auto& stage : m_specialization_constants)
+            CompileShader(*stage.second.front().shader);
+    }
+
     m_changed_binding = true;
     m_context.command_list->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     SetRootSignature(m_root_signature.Get());
@@ -302,39 +309,52 @@ void DX12ProgramApi::CreateShaderTable()
     m_raytrace_desc.HitGroupTable.StrideInBytes = shader_table_entry_size;
 }
 
-void DX12ProgramApi::CompileShader(const ShaderBase& shader)
+DX12ProgramApi::ShaderJob DX12ProgramApi::PrepareShader(const ShaderBase& shader)
 {
-    auto blob = DXCompile(shader);
-    m_blob_map[shader.type] = blob;
-    D3D12_SHADER_BYTECODE ShaderBytecode = {};
-    ShaderBytecode.BytecodeLength = blob->GetBufferSize();
-    ShaderBytecode.pShaderBytecode = blob->GetBufferPointer();
-    switch (shader.type)
+    ShaderDesc desc = GetSpecializedDesc(shader);
+    return [this, desc]() -> std::function<void()>
     {
-    case ShaderType::kVertex:
-    {
-        m_pso_desc.VS = ShaderBytecode;
-        DXReflect(m_blob_map[ShaderType::kVertex]->GetBufferPointer(), m_blob_map[ShaderType::kVertex]->GetBufferSize(), IID_PPV_ARGS(&m_input_layout_reflector));
-        m_input_layout = GetInputLayout(m_input_layout_reflector);
-        break;
-    }
-    case ShaderType::kPixel:
-        m_pso_desc.PS = ShaderBytecode;
-        break;
-    case ShaderType::kCompute:
-        m_compute_pso_desc.CS = ShaderBytecode;
-        m_is_compute = true;
-        break;
-    case ShaderType::kGeometry:
-        m_pso_desc.GS = ShaderBytecode;
-        break;
-    case ShaderType::kLibrary:
-        m_is_compute = true;
-        m_is_dxr = true;
-        break;
-    }
+        ComPtr<ID3DBlob> blob = DXCompile(desc);
+        if (!blob)
+            return {};
+        return [this, desc, blob]
+        {
+            m_blob_map[desc.type] = blob;
+            D3D12_SHADER_BYTECODE ShaderBytecode = {};
+            ShaderBytecode.BytecodeLength = blob->GetBufferSize();
+            ShaderBytecode.pShaderBytecode = blob->GetBufferPointer();
+            switch (desc.type)
+            {
+            case ShaderType::kVertex:
+            {
+                m_pso_desc.VS = ShaderBytecode;
+                DXReflect(m_blob_map[ShaderType::kVertex]->GetBufferPointer(), m_blob_map[ShaderType::kVertex]->GetBufferSize(), IID_PPV_ARGS(&m_input_layout_reflector));
+                m_input_layout = GetInputLayout(m_input_layout_reflector);
+                break;
+            }
+            case ShaderType::kPixel:
+                m_pso_desc.PS = ShaderBytecode;
+                break;
+            case ShaderType::kCompute:
+                m_compute_pso_desc.CS = ShaderBytecode;
+                m_is_compute = true;
+                // The compute PSO is built on the next dispatch, the old one may still be used by frames in flight
+                if (m_current_pso)
+                    m_context.QueryOnDelete(m_current_pso.Get());
+                m_current_pso.Reset();
+                break;
+            case ShaderType::kGeometry:
+                m_pso_desc.GS = ShaderBytecode;
+                break;
+            case ShaderType::kLibrary:
+                m_is_compute = true;
+                m_is_dxr = true;
+                break;
+            }
 
-    m_pso_desc_cache = true;
+            m_pso_desc_cache = true;
+        };
+    };
 }
 
 void DX12ProgramApi::ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color)
@@ -554,6 +574,36 @@ void DX12ProgramApi::OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr&
     m_pso_desc_cache(m_pso_desc.DepthStencilState.DepthEnable) = !!ires;
 }
 
+void DX12ProgramApi::OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires)
+{
+    if (!ires)
+        return;
+
+    // Descriptors are still valid, only the resource state may have changed since
+    DX12Resource& res = static_cast<DX12Resource&>(*ires);
+    switch (bind_key.res_type)
+    {
+    case ResourceType::kSrv:
+        if (bind_key.shader_type == ShaderType::kPixel)
+            m_context.ResourceBarrier(res, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        else
+            m_context.ResourceBarrier(res, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        break;
+    case ResourceType::kUav:
+        m_context.ResourceBarrier(res, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        break;
+    case ResourceType::kRtv:
+        m_context.ResourceBarrier(res, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        // Render targets are context state, another program may have set its own since
+        m_changed_om = true;
+        break;
+    case ResourceType::kDsv:
+        m_context.ResourceBarrier(res, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+        m_changed_om = true;
+        break;
+    }
+}
+
 void DX12ProgramApi::SetRootSignature(ID3D12RootSignature * pRootSignature)
 {
     if (m_is_compute)
@@ -597,8 +647,16 @@ std::vector<D3D12_INPUT_ELEMENT_DESC> DX12ProgramApi::GetInputLayout(ComPtr<ID3D
         layout.SemanticName = param_desc.SemanticName;
         layout.SemanticIndex = param_desc.SemanticIndex;
         layout.InputSlot = i;
-        layout.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
-        layout.InstanceDataStepRate = 0;
+        if (IsInstanceInput(i))
+        {
+            layout.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+            layout.InstanceDataStepRate = 1;
+        }
+        else
+        {
+            layout.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+            layout.InstanceDataStepRate = 0;
+        }
 
         if (param_desc.Mask == 1)
         {
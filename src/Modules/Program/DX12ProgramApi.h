@@ -25,7 +25,7 @@ public:
     virtual void LinkProgram() override;
     void UseProgram();
     virtual void ApplyBindings() override;
-    virtual void CompileShader(const ShaderBase& shader) override;
+    virtual ShaderJob PrepareShader(const ShaderBase& shader) override;
     virtual void ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color) override;
     virtual void ClearDepthStencil(uint32_t ClearFlags, float Depth, uint8_t Stencil) override;
     virtual void SetRasterizeState(const RasterizerDesc& desc) override;
@@ -54,6 +54,7 @@ private:
     virtual void OnAttachSampler(ShaderType type, const std::string& name, uint32_t slot, const Resource::Ptr& ires) override;
     virtual void OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
     virtual void OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr& ires) override;
+    virtual void OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
 
     void SetRootSignature(ID3D12RootSignature* pRootSignature);
     void SetRootDescriptorTable(uint32_t RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor);
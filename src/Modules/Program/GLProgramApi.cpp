@@ -67,7 +67,7 @@ namespace ShaderUtility
     {
         GLuint shader = glCreateShader(shaderType);
         glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, spirv.binary.data(), sizeof(uint32_t) * spirv.binary.size());
-        glSpecializeShader(shader, spirv.entrypoint.c_str(), 0, nullptr, nullptr);
+        glSpecializeShader(shader, spirv.entrypoint.c_str(), static_cast<GLuint>(spirv.constant_ids.size()), spirv.constant_ids.data(), spirv.constant_values.data());
         glCompileShader(shader);
         CheckCompile(shader);
         return shader;
@@ -140,6 +140,11 @@ void GLProgramApi::LinkProgram()
     m_texture_loc.clear();
     m_cbv_bindings.clear();
 
+    SyncSpecializationConstants();
+    UpdateSpecializationConstants();
+    if (m_program)
+        glDeleteProgram(m_program);
+
     if (m_use_spirv)
         m_program = ShaderUtility::CreateProgram(m_spirv);
     else
@@ -151,8 +156,49 @@ void GLProgramApi::LinkProgram()
     ParseShadersOuput();
 }
 
+void GLProgramApi::UpdateSpecializationConstants()
+{
+    for (auto& stage : m_specialization_constants)
+    {
+        if (m_use_spirv)
+        {
+            auto it = m_spirv.find(stage.first);
+            if (it == m_spirv.end())
+                continue;
+            it->second.constant_ids.clear();
+            it->second.constant_values.clear();
+            for (const auto& constant : stage.second)
+            {
+                it->second.constant_ids.push_back(constant.constant_id);
+                it->second.constant_values.push_back(constant.GetValue());
+            }
+        }
+        else
+        {
+            auto it = m_src.find(stage.first);
+            if (it == m_src.end())
+                continue;
+            // SPIRV-Cross guards the default value of every constant with a SPIRV_CROSS_CONSTANT_ID_<id> macro,
+            // the defines following #version are replaced with the current values
+            static const std::string prefix = "#define SPIRV_CROSS_CONSTANT_ID_";
+            std::string& src = it->second;
+            size_t pos = src.find('\n', src.find("#version")) + 1;
+            size_t end = pos;
+            while (src.compare(end, prefix.size(), prefix) == 0)
+                end = src.find('\n', end) + 1;
+            std::string defines;
+            for (const auto& constant : stage.second)
+                defines += prefix + std::to_string(constant.constant_id) + " " + constant.to_string() + "\n";
+            src.replace(pos, end - pos, defines);
+        }
+    }
+}
+
 void GLProgramApi::UseProgram()
 {
+    // Relinking from the stored SPIR-V or GLSL is enough for new values, the HLSL is not compiled again
+    if (SyncSpecializationConstants())
+        LinkProgram();
     glUseProgram(m_program);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
     if (m_is_enabled_blend)
@@ -171,13 +217,15 @@ void GLProgramApi::ApplyBindings()
     for (auto &x : m_cbv_layout)
     {
         BufferLayout& buffer_layout = x.second;
-        auto& res = m_cbv_buffer[{x.first.shader_type, x.first.slot}];
-        if (buffer_layout.SyncData())
+        // Unchanged data keeps its range until the ring moves to the next frame
+        auto& range = m_cbv_ranges[x.first];
+        if (buffer_layout.SyncData() || !m_context.GetConstantRing().IsCurrent(range))
         {
-            m_context.UpdateSubresource(res, 0, buffer_layout.GetBuffer().data(), buffer_layout.GetBuffer().size(), 0);
+            const auto& data = buffer_layout.GetBuffer();
+            range = m_context.GetConstantRing().Allocate(data.data(), data.size());
         }
 
-        GLResource& gl_res = static_cast<GLResource&>(*res);
+        GLResource& gl_res = static_cast<GLResource&>(*range.buffer);
 
         std::string name = GetBindingName(x.first);
         if (name == "$Globals")
@@ -185,20 +233,31 @@ void GLProgramApi::ApplyBindings()
 
         auto it = m_cbv_bindings.find(name);
         assert(it != m_cbv_bindings.end());
-        glBindBufferBase(GL_UNIFORM_BUFFER, it->second, gl_res.buffer);
+        glBindBufferRange(GL_UNIFORM_BUFFER, it->second, gl_res.buffer, range.offset, range.size);
     }
 }
 
-void GLProgramApi::CompileShader(const ShaderBase& shader)
+GLProgramApi::ShaderJob GLProgramApi::PrepareShader(const ShaderBase& shader)
 {
     SpirvOption option = {};
     if (m_shader_types.count(ShaderType::kGeometry) && shader.type == ShaderType::kVertex)
         option.invert_y = false;
     option.vulkan_semantics = false;
-    if (m_use_spirv)
-        m_spirv[shader.type] = { SpirvCompile(shader, option), shader.entrypoint };
-    else
-        m_src[shader.type] = GetGLSLShader(shader, option);
+    ShaderDesc desc = shader;
+    bool use_spirv = m_use_spirv;
+    // GL objects are created by LinkProgram, the front-end produces everything stored here
+    return [this, desc, option, use_spirv]() -> std::function<void()>
+    {
+        if (use_spirv)
+        {
+            auto spirv = SpirvCompile(desc, option);
+            if (spirv.empty())
+                return {};
+            return [this, desc, spirv] { m_spirv[desc.type] = { spirv, desc.entrypoint }; };
+        }
+        auto src = GetGLSLShader(desc, option);
+        return [this, desc, src] { m_src[desc.type] = src; };
+    };
 }
 
 GLenum AttribComponentType(GLenum type)
@@ -362,6 +421,7 @@ void GLProgramApi::ParseShaders()
             glVertexArrayAttribFormat(m_vao, attrib, AttribColumnCount(type), vertex_type, GL_FALSE, 0);
         }
         glVertexArrayAttribBinding(m_vao, attrib, attrib);
+        glVertexArrayBindingDivisor(m_vao, attrib, IsInstanceInput(attrib) ? 1 : 0);
     }
 }
 
@@ -487,6 +547,12 @@ void GLProgramApi::OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr &
     glNamedFramebufferTexture(m_framebuffer, GL_DEPTH_ATTACHMENT, res.texture, 0);
 }
 
+void GLProgramApi::OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires)
+{
+    // Texture units and buffer bindings are shared by all programs, so they are set again on every attach
+    DispatchAttach(bind_key, view_desc, ires);
+}
+
 void GLProgramApi::ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color)
 {
     glClearNamedFramebufferfv(m_framebuffer, GL_COLOR, slot, color.data());
@@ -543,12 +609,3 @@ void GLProgramApi::SetBlendState(const BlendDesc & desc)
 void GLProgramApi::SetDepthStencilState(const DepthStencilDesc& desc)
 {
 }
-
-void GLProgramApi::SetCBufferLayout(const BindKey& bind_key, BufferLayout& buffer_layout)
-{
-    CommonProgramApi::SetCBufferLayout(bind_key, buffer_layout);
-
-    m_cbv_buffer.emplace(std::piecewise_construct,
-        std::forward_as_tuple(bind_key.shader_type, bind_key.slot),
-        std::forward_as_tuple(m_context.CreateBuffer(BindFlag::kCbv, static_cast<uint32_t>(buffer_layout.GetBuffer().size()), 0)));
-}
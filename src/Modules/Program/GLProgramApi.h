@@ -14,6 +14,8 @@ struct SpirvDesc
 {
     std::vector<uint32_t> binary;
     std::string entrypoint;
+    std::vector<GLuint> constant_ids;
+    std::vector<GLuint> constant_values;
 };
 
 class GLProgramApi : public CommonProgramApi
@@ -24,11 +26,12 @@ public:
     virtual void LinkProgram() override;
     void UseProgram();
     virtual void ApplyBindings() override;
-    virtual void CompileShader(const ShaderBase& shader) override;
+    virtual ShaderJob PrepareShader(const ShaderBase& shader) override;
     void ParseShaders();
     void ParseShadersOuput();
     void ParseVariable();
     void ParseSSBO();
+    void UpdateSpecializationConstants();
 
     void OnPresent();
 
@@ -45,6 +48,7 @@ public:
     virtual void OnAttachSampler(ShaderType type, const std::string& name, uint32_t slot, const Resource::Ptr& ires) override;
     virtual void OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
     virtual void OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr& ires) override;
+    virtual void OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
 
     virtual void ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color) override;
     virtual void ClearDepthStencil(uint32_t ClearFlags, float Depth, uint8_t Stencil) override;
@@ -59,15 +63,13 @@ public:
 
     GLuint m_vao;
 
-    virtual void SetCBufferLayout(const BindKey& bind_key, BufferLayout& buffer_layout) override;
-
 private:
     GLContext & m_context;
     std::map<ShaderType, std::string> m_src;
     std::map<ShaderType, SpirvDesc> m_spirv;
     GLuint m_framebuffer;
-    GLuint m_program;
-    std::map<std::tuple<ShaderType, uint32_t>, Resource::Ptr> m_cbv_buffer;
+    GLuint m_program = 0;
+    std::map<BindKey, ConstantRing::Range> m_cbv_ranges;
     std::map<std::string, GLuint> m_cbv_bindings;
     std::map<std::string, std::pair<GLint, GLint>> m_texture_loc;
     std::map<std::string, Resource::Ptr> m_samplers;
@@ -8,7 +8,9 @@
 #include <vector>
 #include <functional>
 #include <Shader/ShaderBase.h>
+#include <Shader/ShaderWatcher.h>
 #include <Program/ProgramApi.h>
+#include <Utilities/State.h>
 #include "Program/BufferLayout.h"
 
 template<typename T>
@@ -42,6 +44,47 @@ public:
     }
 };
 
+class SRVArrayBinding
+{
+public:
+    // Elements take consecutive slots starting at slot, like the registers of an HLSL array
+    SRVArrayBinding(ProgramApi& program_api, ShaderType shader_type, const std::string& name, uint32_t slot, uint32_t count)
+        : m_program_api(program_api)
+        , m_shader_type(shader_type)
+        , m_slot(slot)
+        , m_count(count)
+    {
+        for (uint32_t i = 0; i < m_count; ++i)
+        {
+            BindKey bind_key = GetKey(i);
+            m_program_api.SetBindingName(bind_key, name);
+            m_program_api.SetBindingArrayIndex(bind_key, i);
+        }
+    }
+
+    SRVArrayBinding& Attach(uint32_t index, const Resource::Ptr& ires = {}, const ViewDesc& view_desc = {})
+    {
+        m_program_api.Attach(GetKey(index), view_desc, ires);
+        return *this;
+    }
+
+    uint32_t GetCount() const
+    {
+        return m_count;
+    }
+
+private:
+    BindKey GetKey(uint32_t index) const
+    {
+        return { m_program_api.GetProgramId(), m_shader_type, ResourceType::kSrv, m_slot + index };
+    }
+
+    ProgramApi& m_program_api;
+    ShaderType m_shader_type;
+    uint32_t m_slot;
+    uint32_t m_count;
+};
+
 class UAVBinding : public Binding<UAVBinding>
 {
 public:
@@ -215,6 +258,14 @@ public:
         UpdateShaders();
     }
 
+    ~Program()
+    {
+        EnumerateShader<Args...>([&](ShaderBase& shader)
+        {
+            ShaderWatcher::Instance().Remove(shader);
+        });
+    }
+
     using shader_callback = std::function<void(ShaderBase&)>;
 
     template <typename T>
@@ -232,9 +283,16 @@ public:
         DevNull(ApplyCallback<ShadowsArgs>(fn)...);
     }
 
+    // Creates the backend objects of an async compile, must run on the owning thread before parallel recording
+    void FinishCompilation()
+    {
+        m_program_base->FinishCompilation();
+    }
+
     void LinkProgram()
     {
-        m_program_base->LinkProgram();
+        if (!m_program_base->FinishCompilation())
+            m_program_base->LinkProgram();
     }
 
     void SetRasterizeState(const RasterizerDesc& desc)
@@ -258,13 +316,18 @@ public:
     }
 
 private:
+    // Shaders of the programs constructed one after another compile in parallel, each program links on first use
     void UpdateShaders()
     {
         EnumerateShader<Args...>([&](ShaderBase& shader)
         {
-            shader.UpdateShader();
+            m_program_base->CompileShaderAsync(shader);
+            if (CurState::Instance().shader_hot_reload)
+            {
+                ProgramApi* program_base = m_program_base.get();
+                ShaderWatcher::Instance().Add(shader, [program_base, &shader] { program_base->ReloadShaderAsync(shader); });
+            }
         });
-        m_program_base->LinkProgram();
     }
 
     std::unique_ptr<ProgramApi> m_program_base;
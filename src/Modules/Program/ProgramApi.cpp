@@ -1,4 +1,9 @@
 #include "ProgramApi.h"
+#include <Shader/ShaderBase.h>
+#include <Utilities/TaskPool.h>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
 
 static size_t GenId()
 {
@@ -6,11 +11,29 @@ static size_t GenId()
     return ++id;
 }
 
+static TaskPool& GetShaderCompilerPool()
+{
+    static TaskPool pool;
+    return pool;
+}
+
+// Programs with hot reloaded shaders not swapped in yet
+static std::set<ProgramApi*>& GetReloadingPrograms()
+{
+    static std::set<ProgramApi*> programs;
+    return programs;
+}
+
 ProgramApi::ProgramApi()
     : m_program_id(GenId())
 {
 }
 
+ProgramApi::~ProgramApi()
+{
+    GetReloadingPrograms().erase(this);
+}
+
 size_t ProgramApi::GetProgramId() const
 {
     return m_program_id;
@@ -31,3 +54,146 @@ const std::string& ProgramApi::GetBindingName(const BindKey& bind_key) const
     }
     return it->second;
 }
+
+void ProgramApi::SetBindingArrayIndex(const BindKey& bind_key, uint32_t index)
+{
+    m_binding_array_indices[bind_key] = index;
+}
+
+uint32_t ProgramApi::GetBindingArrayIndex(const BindKey& bind_key) const
+{
+    auto it = m_binding_array_indices.find(bind_key);
+    if (it == m_binding_array_indices.end())
+        return 0;
+    return it->second;
+}
+
+void ProgramApi::SetInstanceInput(uint32_t slot)
+{
+    m_instance_inputs.insert(slot);
+}
+
+bool ProgramApi::IsInstanceInput(uint32_t slot) const
+{
+    return m_instance_inputs.count(slot);
+}
+
+bool ProgramApi::SyncSpecializationConstants()
+{
+    bool changed = false;
+    for (auto& stage : m_specialization_constants)
+    {
+        for (auto& constant : stage.second)
+        {
+            uint32_t value = constant.GetValue();
+            changed = changed || value != constant.applied;
+            constant.applied = value;
+        }
+    }
+    return changed;
+}
+
+ShaderDesc ProgramApi::GetSpecializedDesc(const ShaderBase& shader)
+{
+    ShaderDesc desc = shader;
+    auto it = m_specialization_constants.find(shader.type);
+    if (it == m_specialization_constants.end())
+        return desc;
+    for (auto& constant : it->second)
+    {
+        desc.define[constant.name] = constant.to_string();
+        constant.applied = constant.GetValue();
+    }
+    return desc;
+}
+
+void ProgramApi::CompileShader(const ShaderBase& shader)
+{
+    // Backends expect the stages in the order they were compiled
+    JoinShaders();
+    PrepareShader(shader)()();
+}
+
+void ProgramApi::CompileShaderAsync(const ShaderBase& shader)
+{
+    m_pending_shaders.push_back(GetShaderCompilerPool().Submit(PrepareShader(shader)));
+    m_link_pending = true;
+}
+
+bool ProgramApi::FinishCompilation()
+{
+    if (!m_link_pending)
+        return false;
+    m_link_pending = false;
+    JoinShaders();
+    LinkProgram();
+    return true;
+}
+
+void ProgramApi::JoinShaders()
+{
+    // Compilation errors of the front-end are rethrown here
+    std::vector<std::future<std::function<void()>>> pending = std::move(m_pending_shaders);
+    m_pending_shaders.clear();
+    for (auto& shader : pending)
+    {
+        std::function<void()> create = shader.get();
+        if (!create)
+            throw std::runtime_error("failed to compile shader!");
+        create();
+    }
+}
+
+void ProgramApi::ReloadShaderAsync(const ShaderBase& shader)
+{
+    FinishCompilation();
+    m_pending_reloads.push_back(GetShaderCompilerPool().Submit(PrepareShader(shader)));
+    GetReloadingPrograms().insert(this);
+}
+
+void ProgramApi::ApplyReloads()
+{
+    auto& programs = GetReloadingPrograms();
+    for (auto it = programs.begin(); it != programs.end();)
+    {
+        if ((*it)->ApplyReload())
+            it = programs.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool ProgramApi::ApplyReload()
+{
+    for (auto& shader : m_pending_reloads)
+    {
+        if (shader.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return false;
+    }
+
+    std::vector<std::future<std::function<void()>>> pending = std::move(m_pending_reloads);
+    m_pending_reloads.clear();
+    std::vector<std::function<void()>> creates;
+    for (auto& shader : pending)
+    {
+        try
+        {
+            creates.push_back(shader.get());
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            creates.push_back({});
+        }
+        if (!creates.back())
+        {
+            std::cerr << "Shader reload failed, program " << m_program_id << " keeps the previous shaders" << std::endl;
+            return true;
+        }
+    }
+
+    for (auto& create : creates)
+        create();
+    LinkProgram();
+    return true;
+}
@@ -2,7 +2,12 @@
 
 #include <Context/BaseTypes.h>
 #include <Resource/Resource.h>
+#include <Shader/ShaderDesc.h>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <map>
+#include <set>
 #include <memory>
 #include <vector>
 
@@ -16,13 +21,39 @@ class ProgramApi : public IShaderBlobProvider
 {
 public:
     ProgramApi();
+    virtual ~ProgramApi();
     virtual size_t GetProgramId() const override;
     void SetBindingName(const BindKey& bind_key, const std::string& name);
     const std::string& GetBindingName(const BindKey& bind_key) const;
+    // Elements of a resource array share the binding name and differ by the array index
+    void SetBindingArrayIndex(const BindKey& bind_key, uint32_t index);
+    uint32_t GetBindingArrayIndex(const BindKey& bind_key) const;
+    // Vertex inputs with an INSTANCE_ semantic advance once per instance instead of once per vertex
+    void SetInstanceInput(uint32_t slot);
+    bool IsInstanceInput(uint32_t slot) const;
+    // Specialization constants are 32-bit scalars living in the spec struct of the generated shader,
+    // backends read their current values when a pipeline is created
+    template<typename T>
+    void SetSpecializationConstant(const ShaderBase& shader, ShaderType type, uint32_t constant_id, const std::string& name, const T& value)
+    {
+        static_assert(sizeof(T) == sizeof(uint32_t), "specialization constants are 32-bit scalars");
+        SpecializationConstant constant = { &shader, constant_id, name, &value, [&value] { return std::to_string(value); } };
+        m_specialization_constants[type].push_back(constant);
+    }
     virtual void AddAvailableShaderType(ShaderType type) {}
     virtual void LinkProgram() = 0;
     virtual void ApplyBindings() = 0;
-    virtual void CompileShader(const ShaderBase& shader) = 0;
+    void CompileShader(const ShaderBase& shader);
+    // Runs the front-end compilation on the shader compiler pool, FinishCompilation creates the backend objects and links
+    void CompileShaderAsync(const ShaderBase& shader);
+    // Returns false when nothing was pending and the program was not linked
+    bool FinishCompilation();
+    bool IsCompilationPending() const { return m_link_pending; }
+    // Hot reload: compiles on the shader compiler pool while the current shaders stay in use
+    void ReloadShaderAsync(const ShaderBase& shader);
+    // Called at frame boundaries, every program whose reloaded shaders are all compiled swaps them in and relinks,
+    // a program with a shader failing to compile keeps all of its previous shaders
+    static void ApplyReloads();
     virtual void SetCBufferLayout(const BindKey& bind_key, BufferLayout& buffer_layout) = 0;
     virtual void Attach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res) = 0;
     virtual void ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color) = 0;
@@ -31,6 +62,46 @@ public:
     virtual void SetBlendState(const BlendDesc& desc) = 0;
     virtual void SetDepthStencilState(const DepthStencilDesc& desc) = 0;
 protected:
+    // Called on the owning thread to capture what the front-end needs, the returned job runs on any thread
+    // without touching the program and returns the step creating the backend objects back on the owning thread,
+    // or an empty step when compilation failed
+    using ShaderJob = std::function<std::function<void()>()>;
+    virtual ShaderJob PrepareShader(const ShaderBase& shader) = 0;
+
+    struct SpecializationConstant
+    {
+        const ShaderBase* shader;
+        uint32_t constant_id;
+        std::string name;
+        const void* value;
+        std::function<std::string()> to_string;
+        uint32_t applied = 0;
+
+        uint32_t GetValue() const
+        {
+            uint32_t res = 0;
+            memcpy(&res, value, sizeof(res));
+            return res;
+        }
+    };
+
+    // Returns true when any value changed since the previous call
+    bool SyncSpecializationConstants();
+    // For backends without specialization constants, the current values are passed as defines of the same name
+    ShaderDesc GetSpecializedDesc(const ShaderBase& shader);
+
     size_t m_program_id;
     std::map<BindKey, std::string> m_binding_names;
+    std::map<BindKey, uint32_t> m_binding_array_indices;
+    std::set<uint32_t> m_instance_inputs;
+    std::map<ShaderType, std::vector<SpecializationConstant>> m_specialization_constants;
+
+private:
+    void JoinShaders();
+    // Returns false while some of the reloaded shaders are still compiling
+    bool ApplyReload();
+
+    std::vector<std::future<std::function<void()>>> m_pending_shaders;
+    bool m_link_pending = false;
+    std::vector<std::future<std::function<void()>>> m_pending_reloads;
 };
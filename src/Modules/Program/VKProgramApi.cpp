@@ -1,18 +1,31 @@
 #include "VKProgramApi.h"
 
 #include <vector>
-#include <list>
+#include <cstring>
+#include <string_view>
 #include <utility>
 #include <Resource/VKResource.h>
 #include <View/VKView.h>
 #include <Shader/SpirvCompiler.h>
+#include <Shader/SpirvPatcher.h>
 #include <iostream>
 #include <Utilities/VKUtility.h>
+#include <atomic>
+
+namespace
+{
+    uint64_t GenLinkId()
+    {
+        static std::atomic<uint64_t> id{ 0 };
+        return ++id;
+    }
+}
 
 VKProgramApi::VKProgramApi(VKContext& context)
     : CommonProgramApi(context)
     , m_context(context)
     , m_view_creater(context, *this)
+    , m_heap_cache(context)
 {
     m_depth_stencil_desc.depth_enable = true;
 }
@@ -35,9 +48,11 @@ VkShaderStageFlagBits VKProgramApi::ShaderType2Bit(ShaderType type)
 
 void VKProgramApi::LinkProgram()
 {
+    m_link_id = GenLinkId();
     ParseShaders();
     m_view_creater.OnLinkProgram();
 
+    shaderStageCreateInfo.clear();
     for (auto & shader : m_shaders_info)
     {
         shaderStageCreateInfo.emplace_back();
@@ -49,6 +64,8 @@ void VKProgramApi::LinkProgram()
         shaderStageCreateInfo.back().pSpecializationInfo = NULL;
     }
 
+    binding_desc.clear();
+    attribute_desc.clear();
     if (m_spirv.count(ShaderType::kVertex))
     {
         CreateInputLayout(m_spirv[ShaderType::kVertex], binding_desc, attribute_desc);
@@ -57,10 +74,99 @@ void VKProgramApi::LinkProgram()
     {
         CreateRenderPass(m_spirv[ShaderType::kPixel]);
     }
+
+    CreateDescriptorSetTables();
+    // The pipeline of the previous link was created from the old shaders and layout
+    m_changed_om = true;
+}
+
+VKPipelineKey VKProgramApi::GetGrPipelineKey() const
+{
+    VKPipelineKey key;
+    key.Add(m_link_id);
+    key.Add(reinterpret_cast<uint64_t>(m_pipeline_layout));
+    key.Add(shaderStageCreateInfo.size());
+    for (const auto& stage : shaderStageCreateInfo)
+    {
+        key.Add(static_cast<uint32_t>(stage.stage));
+        key.Add(reinterpret_cast<uint64_t>(stage.module));
+        key.Add(std::string(stage.pName));
+    }
+    for (const auto& stage : m_specialization_info)
+    {
+        key.Add(stage.second.data.size());
+        for (uint32_t value : stage.second.data)
+            key.Add(value);
+    }
+    key.Add(binding_desc.size());
+    for (const auto& binding : binding_desc)
+    {
+        key.Add(binding.binding);
+        key.Add(binding.stride);
+        key.Add(static_cast<uint32_t>(binding.inputRate));
+    }
+    key.Add(attribute_desc.size());
+    for (const auto& attribute : attribute_desc)
+    {
+        key.Add(attribute.location);
+        key.Add(attribute.binding);
+        key.Add(static_cast<uint32_t>(attribute.format));
+        key.Add(attribute.offset);
+    }
+    key.Add(m_attachment_descriptions.size());
+    for (size_t i = 0; i + 1 < m_attachment_descriptions.size(); ++i)
+    {
+        key.Add(static_cast<uint32_t>(m_attachment_descriptions[i].format));
+        key.Add(static_cast<uint32_t>(m_attachment_descriptions[i].samples));
+    }
+    bool has_depth = m_attachment_views.back() != VK_NULL_HANDLE;
+    key.Add(has_depth);
+    if (has_depth)
+        key.Add(static_cast<uint32_t>(m_attachment_descriptions.back().format));
+    key.Add(msaa_count);
+    key.Add(reinterpret_cast<uint64_t>(m_render_pass));
+
+    key.Add(m_rasterizer_desc.DepthBias);
+
+    key.Add(m_blend_desc.blend_enable);
+    if (m_blend_desc.blend_enable)
+    {
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_src));
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_dest));
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_op));
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_src_alpha));
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_dest_apha));
+        key.Add(static_cast<uint32_t>(m_blend_desc.blend_op_alpha));
+    }
+
+    key.Add(m_depth_stencil_desc.depth_enable);
+    key.Add(static_cast<uint32_t>(m_depth_stencil_desc.func));
+    return key;
+}
+
+VKPipelineKey VKProgramApi::GetComputePipelineKey() const
+{
+    VKPipelineKey key;
+    key.Add(m_link_id);
+    key.Add(reinterpret_cast<uint64_t>(m_pipeline_layout));
+    key.Add(reinterpret_cast<uint64_t>(shaderStageCreateInfo.front().module));
+    key.Add(std::string(shaderStageCreateInfo.front().pName));
+    for (const auto& stage : m_specialization_info)
+    {
+        key.Add(stage.second.data.size());
+        for (uint32_t value : stage.second.data)
+            key.Add(value);
+    }
+    return key;
 }
 
 void VKProgramApi::CreateGrPipeLine()
 {
+    VKPipelineKey key = GetGrPipelineKey();
+    graphicsPipeline = m_context.GetPipelineCache().Find(key);
+    if (graphicsPipeline != VK_NULL_HANDLE)
+        return;
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
@@ -179,22 +285,57 @@ void VKProgramApi::CreateGrPipeLine()
 
     pipelineInfo.pDynamicState = &pipelineDynamicStateCreateInfo;
 
-    if (vkCreateGraphicsPipelines(m_context.m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to vkCreateGraphicsPipelines");
-    }
+    graphicsPipeline = m_context.GetPipelineCache().CreateGraphicsPipeline(key, pipelineInfo);
 }
 
 void VKProgramApi::CreateComputePipeLine()
 {
+    VKPipelineKey key = GetComputePipelineKey();
+    graphicsPipeline = m_context.GetPipelineCache().Find(key);
+    if (graphicsPipeline != VK_NULL_HANDLE)
+        return;
+
     VkComputePipelineCreateInfo pipeline_info = {};
     pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
     pipeline_info.stage = shaderStageCreateInfo.front();
     pipeline_info.layout = m_pipeline_layout;
-    ASSERT_SUCCEEDED(vkCreateComputePipelines(m_context.m_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphicsPipeline));
+    graphicsPipeline = m_context.GetPipelineCache().CreateComputePipeline(key, pipeline_info);
+}
+
+void VKProgramApi::UpdateSpecializationInfo()
+{
+    m_specialization_info.clear();
+    size_t stage_index = 0;
+    for (auto& shader : m_shaders_info)
+    {
+        VkPipelineShaderStageCreateInfo& stage = shaderStageCreateInfo[stage_index++];
+        stage.pSpecializationInfo = nullptr;
+
+        auto it = m_specialization_constants.find(shader.first);
+        if (it == m_specialization_constants.end() || it->second.empty())
+            continue;
+
+        SpecializationInfo& specialization = m_specialization_info[shader.first];
+        for (const auto& constant : it->second)
+        {
+            VkSpecializationMapEntry entry = {};
+            entry.constantID = constant.constant_id;
+            entry.offset = static_cast<uint32_t>(sizeof(uint32_t) * specialization.data.size());
+            entry.size = sizeof(uint32_t);
+            specialization.entries.push_back(entry);
+            specialization.data.push_back(constant.GetValue());
+        }
+        specialization.info.mapEntryCount = static_cast<uint32_t>(specialization.entries.size());
+        specialization.info.pMapEntries = specialization.entries.data();
+        specialization.info.dataSize = sizeof(uint32_t) * specialization.data.size();
+        specialization.info.pData = specialization.data.data();
+        stage.pSpecializationInfo = &specialization.info;
+    }
 }
 
 void VKProgramApi::CreatePipeLine()
 {
+    UpdateSpecializationInfo();
     if (m_is_compute)
         CreateComputePipeLine();
     else
@@ -205,96 +346,137 @@ void VKProgramApi::UseProgram()
 {
 }
 
+void VKProgramApi::UpdateCBufferRanges()
+{
+    ConstantRing& constant_ring = m_context.GetConstantRing();
+    for (auto& x : m_cbv_layout)
+    {
+        if (FindPushConstantBlock(x.first))
+            continue;
+        BufferLayout& buffer_layout = x.second;
+        auto& range = m_cbv_ranges[x.first];
+        if (!buffer_layout.SyncData() && constant_ring.IsCurrent(range))
+            continue;
+
+        const auto& data = buffer_layout.GetBuffer();
+        range = constant_ring.Allocate(data.data(), data.size());
+
+        // The descriptor points at the whole chunk, moving inside of it only changes the dynamic offset
+        auto it = m_bound_resources.find(x.first);
+        if (it == m_bound_resources.end() || it->second.res != range.buffer)
+            BindResource(x.first, {}, range.buffer);
+    }
+}
+
 void VKProgramApi::ApplyBindings()
 {
-    UpdateCBuffers();
+    UpdateCBufferRanges();
 
+    // New values of specialization constants only select another pipeline, the shader modules stay the same
+    bool changed_pipeline = SyncSpecializationConstants();
     if (m_changed_om)
     {
         if (!m_is_compute)
         {
-            for (int i = 0; i < m_attachment_descriptions.size() - 1; ++i)
+            RenderPassDesc render_pass_desc;
+            m_has_pending_clear = false;
+            for (size_t i = 0; i < m_attachment_descriptions.size() - 1; ++i)
             {
-                m_attachment_descriptions[i].loadOp = m_clear_cache.GetColorLoadOp(i);
+                render_pass_desc.colors.emplace_back();
+                auto& color = render_pass_desc.colors.back();
+                color.format = m_attachment_descriptions[i].format;
+                color.samples = m_attachment_descriptions[i].samples;
+                color.load_op = m_clear_cache.GetColorLoadOp(i);
+                m_has_pending_clear |= color.load_op == VK_ATTACHMENT_LOAD_OP_CLEAR;
                 m_clear_cache.GetColorLoadOp(i) = VK_ATTACHMENT_LOAD_OP_LOAD;
             }
             if (m_attachment_views.back())
-                m_attachment_descriptions.back().loadOp = m_clear_cache.GetDepthLoadOp();
+            {
+                render_pass_desc.has_depth = true;
+                auto& depth = render_pass_desc.depth;
+                depth.format = m_attachment_descriptions.back().format;
+                depth.samples = m_attachment_descriptions.back().samples;
+                depth.load_op = m_clear_cache.GetDepthLoadOp();
+                depth.stencil_load_op = m_clear_cache.GetDepthLoadOp();
+                depth.stencil_store_op = VK_ATTACHMENT_STORE_OP_STORE;
+                m_has_pending_clear |= depth.load_op == VK_ATTACHMENT_LOAD_OP_CLEAR;
+            }
             m_clear_cache.GetDepthLoadOp() = VK_ATTACHMENT_LOAD_OP_LOAD;
-            VkSubpassDescription subPass = {};
-            subPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-            subPass.colorAttachmentCount = m_attachment_references.size() - 1;
-            subPass.pColorAttachments = m_attachment_references.data();
-            subPass.pDepthStencilAttachment = &m_attachment_references.back();
-            if (!m_attachment_views.back())
-                subPass.pDepthStencilAttachment = nullptr;
+            m_render_pass = m_context.GetRenderPassCache().GetRenderPass(render_pass_desc);
 
-            VkRenderPassCreateInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-            renderPassInfo.attachmentCount = m_attachment_descriptions.size();
+            FramebufferDesc framebuffer_desc;
+            framebuffer_desc.views = m_attachment_views;
             if (!m_attachment_views.back())
-                --renderPassInfo.attachmentCount;
-            renderPassInfo.pAttachments = m_attachment_descriptions.data();
-            renderPassInfo.subpassCount = 1;
-            renderPassInfo.pSubpasses = &subPass;
-
-           VkAccessFlags AccessMask =
-                VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
-                VK_ACCESS_INDEX_READ_BIT |
-                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
-                VK_ACCESS_UNIFORM_READ_BIT |
-                VK_ACCESS_INPUT_ATTACHMENT_READ_BIT |
-                VK_ACCESS_SHADER_READ_BIT |
-                VK_ACCESS_SHADER_WRITE_BIT |
-                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
-                VK_ACCESS_TRANSFER_READ_BIT |
-                VK_ACCESS_TRANSFER_WRITE_BIT |
-                VK_ACCESS_HOST_READ_BIT |
-                VK_ACCESS_HOST_WRITE_BIT |
-                VK_ACCESS_MEMORY_READ_BIT |
-                VK_ACCESS_MEMORY_WRITE_BIT;
-
-            VkSubpassDependency self_dependencie = {};
-            self_dependencie.srcStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-            self_dependencie.dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-            self_dependencie.srcAccessMask = AccessMask;
-            self_dependencie.dstAccessMask = AccessMask;
-            self_dependencie.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-            renderPassInfo.dependencyCount = 1;
-            renderPassInfo.pDependencies = &self_dependencie;
-
-            vkCreateRenderPass(m_context.m_device, &renderPassInfo, nullptr, &m_render_pass);
-
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = m_render_pass;
-            framebufferInfo.attachmentCount = m_attachment_views.size();
-            if (!m_attachment_views.back())
-                --framebufferInfo.attachmentCount;
-            framebufferInfo.pAttachments = m_attachment_views.data();
-            framebufferInfo.width = m_rtv_size[0].first.width;
-            framebufferInfo.height = m_rtv_size[0].first.height;
-            framebufferInfo.layers = m_rtv_size[0].second;
-
-            if (vkCreateFramebuffer(m_context.m_device, &framebufferInfo, nullptr, &m_framebuffer) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
+                framebuffer_desc.views.pop_back();
+            framebuffer_desc.width = m_rtv_size[0].first.width;
+            framebuffer_desc.height = m_rtv_size[0].first.height;
+            framebuffer_desc.layers = m_rtv_size[0].second;
+            m_framebuffer = m_context.GetRenderPassCache().GetFramebuffer(framebuffer_desc, m_render_pass);
         }
         m_changed_om = false;
-        CreatePipeLine();
+        changed_pipeline = true;
     }
+    if (changed_pipeline)
+        CreatePipeLine();
 
     if (m_is_compute)
-        vkCmdBindPipeline(m_context.m_cmd_bufs[m_context.GetFrameIndex()], VK_PIPELINE_BIND_POINT_COMPUTE, graphicsPipeline);
+        vkCmdBindPipeline(m_context.GetCommandBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, graphicsPipeline);
     else
-        vkCmdBindPipeline(m_context.m_cmd_bufs[m_context.GetFrameIndex()], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdBindPipeline(m_context.GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-    std::map<BindKey, View::Ptr> descriptor_cache;
-    for (auto& x : m_bound_resources)
+    BindDescriptorSets();
+    UpdatePushConstants();
+}
+
+bool VKProgramApi::IsBound(VkDescriptorType descriptor_type, const DescriptorData& data)
+{
+    switch (descriptor_type)
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return data.image_info.sampler != VK_NULL_HANDLE;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        return data.image_info.imageView != VK_NULL_HANDLE;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return data.texel_buffer_view != VK_NULL_HANDLE;
+    default:
+        return data.buffer_info.buffer != VK_NULL_HANDLE;
+    }
+}
+
+void VKProgramApi::CreateDescriptorSetTables()
+{
+    DestroyDescriptorSetTables();
+    m_set_tables.resize(m_descriptor_set_layouts.size());
+
+    DescriptorData empty_data;
+    memset(&empty_data, 0, sizeof(empty_data));
+    for (auto& shader_ref_it : m_shader_ref)
+    {
+        DescriptorSetTable& table = m_set_tables[GetSetNumByShaderType(shader_ref_it.first)];
+        std::map<uint32_t, const ShaderRef::ResourceRef*> resources_by_binding;
+        for (auto& res : shader_ref_it.second.resources)
+            resources_by_binding[res.second.binding] = &res.second;
+
+        for (auto& x : resources_by_binding)
+        {
+            VkDescriptorUpdateTemplateEntryKHR entry = {};
+            entry.dstBinding = x.first;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = x.second->array_size;
+            entry.descriptorType = x.second->descriptor_type;
+            entry.offset = table.data.size() * sizeof(DescriptorData);
+            entry.stride = sizeof(DescriptorData);
+            table.entries.push_back(entry);
+            table.data.resize(table.data.size() + entry.descriptorCount, empty_data);
+        }
+        ASSERT(table.entries.size() <= 64);
+    }
+
+    // Names are resolved once here, binding a resource then writes straight into its element of data
+    std::vector<std::map<uint32_t, BindKey>> dynamic_cbvs(m_set_tables.size());
+    for (auto& x : m_binding_names)
     {
         const BindKey& bind_key = x.first;
         switch (bind_key.res_type)
@@ -303,122 +485,261 @@ void VKProgramApi::ApplyBindings()
         case ResourceType::kSrv:
         case ResourceType::kUav:
         case ResourceType::kSampler:
-            descriptor_cache[bind_key] = x.second.view;
             break;
+        default:
+            continue;
         }
+
+        auto shader_ref_it = m_shader_ref.find(bind_key.shader_type);
+        if (shader_ref_it == m_shader_ref.end())
+            continue;
+        std::string name = x.second;
+        if (name == "$Globals")
+            name = "_Global";
+        auto ref_it = shader_ref_it->second.resources.find(name);
+        if (ref_it == shader_ref_it->second.resources.end())
+            continue;
+        const ShaderRef::ResourceRef& ref_res = ref_it->second;
+
+        size_t set_num = GetSetNumByShaderType(bind_key.shader_type);
+        DescriptorSetTable& table = m_set_tables[set_num];
+        auto entry = std::find_if(table.entries.begin(), table.entries.end(), [&](const VkDescriptorUpdateTemplateEntryKHR& entry) { return entry.dstBinding == ref_res.binding; });
+        uint32_t array_index = GetBindingArrayIndex(bind_key);
+        if (entry == table.entries.end() || array_index >= entry->descriptorCount)
+            continue;
+
+        m_descriptor_slots[bind_key] = { set_num, entry->offset / sizeof(DescriptorData) + array_index, ref_res.descriptor_type };
+        if (ref_res.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            dynamic_cbvs[set_num][ref_res.binding] = bind_key;
+    }
+
+    // Dynamic offsets are consumed in the order of bindings inside of a set
+    for (size_t i = 0; i < m_set_tables.size(); ++i)
+    {
+        for (auto& x : dynamic_cbvs[i])
+            m_set_tables[i].dynamic_cbvs.push_back(x.second);
+        m_set_tables[i].dynamic_offsets.resize(m_set_tables[i].dynamic_cbvs.size());
+    }
+
+    // Sets created for the previous layouts are no longer compatible
+    for (size_t i = 0; i < Context::FrameCount; ++i)
+        m_heap_cache[i].assign(m_set_tables.size(), {});
+    m_dirty_sets = ~0u;
+    m_bound_cmd_buf = VK_NULL_HANDLE;
+
+    for (auto& x : m_bound_resources)
+        OnSetBinding(x.first, x.second);
+}
+
+void VKProgramApi::DestroyDescriptorSetTables()
+{
+    for (auto& table : m_set_tables)
+    {
+        for (auto& x : table.templates)
+            m_context.m_vkDestroyDescriptorUpdateTemplateKHR(m_context.m_device, x.second, nullptr);
     }
+    m_set_tables.clear();
+    m_descriptor_slots.clear();
+}
 
-    auto it = m_heap_cache.find(descriptor_cache);
-    if (it == m_heap_cache.end())
+void VKProgramApi::OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires)
+{
+    if (!ires)
+        return;
+
+    // Views and descriptors are still valid, only the image may have been moved to another layout since
+    VKResource& res = static_cast<VKResource&>(*ires);
+    if (res.image.res == VK_NULL_HANDLE)
+        return;
+
+    switch (bind_key.res_type)
     {
-        m_descriptor_sets.clear();
-        for (size_t i = 0; i < m_descriptor_set_layouts.size(); ++i)
+    case ResourceType::kSrv:
+        m_context.TransitionImageLayout(res.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, view_desc);
+        break;
+    case ResourceType::kUav:
+        m_context.TransitionImageLayout(res.image, VK_IMAGE_LAYOUT_GENERAL, view_desc);
+        break;
+    case ResourceType::kRtv:
+        m_context.TransitionImageLayout(res.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, view_desc);
+        break;
+    case ResourceType::kDsv:
+        m_context.TransitionImageLayout(res.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, view_desc);
+        break;
+    }
+}
+
+void VKProgramApi::OnSetBinding(const BindKey& bind_key, const BoundResource& bound_res)
+{
+    auto it = m_descriptor_slots.find(bind_key);
+    if (it == m_descriptor_slots.end())
+        return;
+    const DescriptorSlot& slot = it->second;
+
+    DescriptorData data;
+    memset(&data, 0, sizeof(data));
+    if (bound_res.res)
+    {
+        VKResource& res = static_cast<VKResource&>(*bound_res.res);
+        auto& view = static_cast<VKView&>(*bound_res.view);
+        switch (slot.descriptor_type)
         {
-            m_descriptor_sets.emplace_back(m_context.GetDescriptorPool().AllocateDescriptorSet(m_descriptor_set_layouts[i], m_descriptor_count_by_set[i]));
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            data.image_info.sampler = res.sampler.res;
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            data.image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            data.image_info.imageView = view.srv;
+            break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            data.image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            data.image_info.imageView = view.srv;
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            data.buffer_info.buffer = res.buffer.res;
+            data.buffer_info.offset = 0;
+            data.buffer_info.range = VK_WHOLE_SIZE;
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        {
+            auto range_it = m_cbv_ranges.find(bind_key);
+            data.buffer_info.buffer = res.buffer.res;
+            data.buffer_info.offset = 0;
+            data.buffer_info.range = range_it != m_cbv_ranges.end() ? range_it->second.size : VK_WHOLE_SIZE;
+            break;
         }
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
 
-        std::vector<VkWriteDescriptorSet> descriptorWrites;
-        std::list<VkDescriptorImageInfo> list_image_info;
-        std::list<VkDescriptorBufferInfo> list_buffer_info;
+    DescriptorData& dst = m_set_tables[slot.set_num].data[slot.index];
+    if (memcmp(&dst, &data, sizeof(data)) == 0)
+        return;
+    dst = data;
+    m_dirty_sets |= 1u << slot.set_num;
+}
+
+VkDescriptorSet VKProgramApi::UpdateDescriptorSet(size_t set_num)
+{
+    DescriptorSetTable& table = m_set_tables[set_num];
+    std::vector<DescriptorData> data = table.data;
 
-        for (auto& x : m_bound_resources)
+    // Every element of an array may be indexed by the shader, unbound ones repeat the first bound element
+    uint64_t bound_mask = 0;
+    for (size_t i = 0; i < table.entries.size(); ++i)
+    {
+        const VkDescriptorUpdateTemplateEntryKHR& entry = table.entries[i];
+        auto first = data.begin() + entry.offset / sizeof(DescriptorData);
+        auto last = first + entry.descriptorCount;
+        auto first_bound = std::find_if(first, last, [&](const DescriptorData& x) { return IsBound(entry.descriptorType, x); });
+        if (first_bound == last)
+            continue;
+        for (auto it = first; it != last; ++it)
         {
-            bool is_rtv_dsv = false;
-            switch (x.first.res_type)
-            {
-            case ResourceType::kRtv:
-            case ResourceType::kDsv:
-                is_rtv_dsv = true;
-                break;
-            }
+            if (!IsBound(entry.descriptorType, *it))
+                *it = *first_bound;
+        }
+        bound_mask |= 1ull << i;
+    }
 
-            if (is_rtv_dsv || !x.second.res)
-                continue;
-
-            auto& view = static_cast<VKView&>(*x.second.view);
-            ShaderType shader_type = x.first.shader_type;
-            ShaderRef& shader_ref = m_shader_ref.find(shader_type)->second;
-            std::string name = GetBindingName(x.first);
-            if (name == "$Globals")
-                name = "_Global";
-
-            if (!shader_ref.resources.count(name))
-                throw std::runtime_error("failed to find resource reflection");
-            auto ref_res = shader_ref.resources[name];
-            VKResource& res = static_cast<VKResource&>(*x.second.res);
-
-            VkWriteDescriptorSet descriptorWrite = {};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = m_descriptor_sets[GetSetNumByShaderType(shader_type)];
-            descriptorWrite.dstBinding = ref_res.binding;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = ref_res.descriptor_type;
-            descriptorWrite.descriptorCount = 1;
-
-            switch (ref_res.descriptor_type)
-            {
-            case VK_DESCRIPTOR_TYPE_SAMPLER:
-            {
-                list_image_info.emplace_back();
-                VkDescriptorImageInfo& image_info = list_image_info.back();
-                image_info.sampler = res.sampler.res;
-                descriptorWrite.pImageInfo = &image_info;
-                break;
-            }
-            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-            {
-                list_image_info.emplace_back();
-                VkDescriptorImageInfo& image_info = list_image_info.back();
-                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                image_info.imageView = view.srv;
-                descriptorWrite.pImageInfo = &image_info;
-                break;
-            }
-            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-            {
-                list_image_info.emplace_back();
-                VkDescriptorImageInfo& image_info = list_image_info.back();
-                image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-                image_info.imageView = view.srv;
-                descriptorWrite.pImageInfo = &image_info;
-                break;
-            }
-            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            {
-                list_buffer_info.emplace_back();
-                VkDescriptorBufferInfo& buffer_info = list_buffer_info.back();
-                buffer_info.buffer = res.buffer.res;
-                buffer_info.offset = 0;
-                buffer_info.range = VK_WHOLE_SIZE;
-                descriptorWrite.pBufferInfo = &buffer_info;
-                break;
-            }
-            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-            default:
-                ASSERT(false);
-                break;
-            }
+    size_t data_size = data.size() * sizeof(DescriptorData);
+    uint64_t hash = std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(data.data()), data_size));
+    auto& heap_cache = m_heap_cache.get()[set_num];
+    auto it = heap_cache.find(hash);
+    if (it != heap_cache.end() && memcmp(it->second.data.data(), data.data(), data_size) == 0)
+        return it->second.set;
+
+    VkDescriptorSet set = m_context.GetDescriptorPool().AllocateDescriptorSet(m_descriptor_set_layouts[set_num], m_descriptor_count_by_set[set_num]);
+    if (bound_mask)
+        m_context.m_vkUpdateDescriptorSetWithTemplateKHR(m_context.m_device, set, GetUpdateTemplate(set_num, bound_mask), data.data());
+    heap_cache[hash] = { std::move(data), set };
+    return set;
+}
+
+VkDescriptorUpdateTemplateKHR VKProgramApi::GetUpdateTemplate(size_t set_num, uint64_t bound_mask)
+{
+    DescriptorSetTable& table = m_set_tables[set_num];
+    auto it = table.templates.find(bound_mask);
+    if (it != table.templates.end())
+        return it->second;
 
-            if (descriptorWrite.pImageInfo || descriptorWrite.pBufferInfo)
-                descriptorWrites.push_back(descriptorWrite);
+    std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+    for (size_t i = 0; i < table.entries.size(); ++i)
+    {
+        if (bound_mask & (1ull << i))
+            entries.push_back(table.entries[i]);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfoKHR template_info = {};
+    template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+    template_info.descriptorUpdateEntryCount = entries.size();
+    template_info.pDescriptorUpdateEntries = entries.data();
+    template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    template_info.descriptorSetLayout = m_descriptor_set_layouts[set_num];
+
+    VkDescriptorUpdateTemplateKHR update_template = VK_NULL_HANDLE;
+    ASSERT_SUCCEEDED(m_context.m_vkCreateDescriptorUpdateTemplateKHR(m_context.m_device, &template_info, nullptr, &update_template));
+    table.templates.emplace(bound_mask, update_template);
+    return update_template;
+}
+
+void VKProgramApi::BindDescriptorSets()
+{
+    // Sets stay bound across draws of this program, until another program or command buffer takes over
+    VkCommandBuffer cmd_buf = m_context.GetCommandBuffer();
+    VKProgramApi*& bound_sets_program = m_context.GetBoundSetsProgram();
+    bool rebind_all = bound_sets_program != this || m_bound_cmd_buf != cmd_buf;
+    bound_sets_program = this;
+    m_bound_cmd_buf = cmd_buf;
+
+    VkPipelineBindPoint bind_point = m_is_compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+    for (size_t i = 0; i < m_set_tables.size(); ++i)
+    {
+        DescriptorSetTable& table = m_set_tables[i];
+        bool rebind = rebind_all;
+        if (m_dirty_sets & (1u << i))
+        {
+            VkDescriptorSet set = UpdateDescriptorSet(i);
+            rebind = rebind || set != table.set;
+            table.set = set;
+        }
+
+        // Per-draw constants only move the dynamic offsets
+        for (size_t j = 0; j < table.dynamic_cbvs.size(); ++j)
+        {
+            auto range_it = m_cbv_ranges.find(table.dynamic_cbvs[j]);
+            uint32_t offset = range_it != m_cbv_ranges.end() ? static_cast<uint32_t>(range_it->second.offset) : 0;
+            rebind = rebind || offset != table.dynamic_offsets[j];
+            table.dynamic_offsets[j] = offset;
         }
 
-        if (!descriptorWrites.empty())
-            vkUpdateDescriptorSets(m_context.m_device, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
-        it = m_heap_cache.emplace(descriptor_cache, m_descriptor_sets).first;
+        if (rebind)
+            vkCmdBindDescriptorSets(cmd_buf, bind_point, m_pipeline_layout, i, 1, &table.set, table.dynamic_offsets.size(), table.dynamic_offsets.data());
     }
-    m_descriptor_sets = it->second;
+    m_dirty_sets = 0;
+}
 
-    if (m_is_compute)
-        vkCmdBindDescriptorSets(m_context.m_cmd_bufs[m_context.GetFrameIndex()], VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0,
-            m_descriptor_sets.size(), m_descriptor_sets.data(), 0, nullptr);
-    else
-        vkCmdBindDescriptorSets(m_context.m_cmd_bufs[m_context.GetFrameIndex()], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0,
-            m_descriptor_sets.size(), m_descriptor_sets.data(), 0, nullptr);
+void VKProgramApi::UpdatePushConstants()
+{
+    if (m_push_constant_blocks.empty())
+        return;
+
+    // Push constants live in the command buffer, so they are recorded with every draw even when unchanged
+    for (auto& x : m_cbv_layout)
+    {
+        const PushConstantBlock* block = FindPushConstantBlock(x.first);
+        if (!block)
+            continue;
+        BufferLayout& buffer_layout = x.second;
+        buffer_layout.SyncData();
+        const auto& data = buffer_layout.GetBuffer();
+        uint32_t size = std::min<uint32_t>(block->size, static_cast<uint32_t>(data.size()) & ~3u);
+        if (size)
+            vkCmdPushConstants(m_context.GetCommandBuffer(), m_pipeline_layout, ShaderType2Bit(x.first.shader_type), block->offset, size, data.data());
+    }
 }
 
 View::Ptr VKProgramApi::CreateView(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res)
@@ -426,7 +747,7 @@ View::Ptr VKProgramApi::CreateView(const BindKey& bind_key, const ViewDesc& view
     return m_view_creater.GetView(m_program_id, bind_key.shader_type, bind_key.res_type, bind_key.slot, view_desc, GetBindingName(bind_key), res);
 }
 
-void VKProgramApi::RenderPassBegin()
+void VKProgramApi::RenderPassBegin(VkSubpassContents contents)
 {
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -450,13 +771,18 @@ void VKProgramApi::RenderPassBegin()
     renderPassInfo.clearValueCount = clearValues.size();
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(m_context.m_cmd_bufs[m_context.GetFrameIndex()], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(m_context.GetCommandBuffer(), &renderPassInfo, contents);
+
+    // Clears are done once, following draws switch to the compatible load-only render pass
+    if (m_has_pending_clear)
+    {
+        m_has_pending_clear = false;
+        m_changed_om = true;
+    }
 }
 
-void VKProgramApi::CompileShader(const ShaderBase& shader)
+VKProgramApi::ShaderJob VKProgramApi::PrepareShader(const ShaderBase& shader)
 {
-    if (shader.type == ShaderType::kCompute)
-        m_is_compute = true;
     SpirvOption option;
     option.auto_map_bindings = true;
     option.hlsl_iomap = true;
@@ -466,19 +792,92 @@ void VKProgramApi::CompileShader(const ShaderBase& shader)
     if (m_shader_types.count(ShaderType::kGeometry) && shader.type == ShaderType::kVertex)
         option.invert_y = false;
     option.resource_set_binding = GetSetNumByShaderType(shader.type);
-    auto spirv = SpirvCompile(shader, option);
-    m_spirv[shader.type] = spirv;
+    ShaderDesc desc = shader;
+    return [this, &shader, desc, option]() -> std::function<void()>
+    {
+        auto spirv = SpirvCompile(desc, option);
+        if (spirv.empty())
+            return {};
+        return [this, &shader, spirv]() mutable
+        {
+            if (shader.type == ShaderType::kCompute)
+                m_is_compute = true;
+            // Push constant ranges of a stage follow the ranges of the stages created before it
+            PromotePushConstants(shader.type, spirv);
+            m_spirv[shader.type] = spirv;
+
+            VkShaderModuleCreateInfo vertexShaderCreationInfo = {};
+            vertexShaderCreationInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            vertexShaderCreationInfo.codeSize = sizeof(uint32_t) * spirv.size();
+            vertexShaderCreationInfo.pCode = spirv.data();
+
+            VkShaderModule shaderModule;
+            ASSERT_SUCCEEDED(vkCreateShaderModule(m_context.m_device, &vertexShaderCreationInfo, nullptr, &shaderModule));
+            // Pipelines of frames in flight may still be created from the module of a reloaded shader
+            auto it = m_shaders.find(shader.type);
+            if (it != m_shaders.end())
+            {
+                VkDevice device = m_context.m_device;
+                VkShaderModule old_module = it->second;
+                m_context.QueryOnDelete([device, old_module] { vkDestroyShaderModule(device, old_module, nullptr); });
+            }
+            m_shaders[shader.type] = shaderModule;
+            m_shaders_info[shader.type] = shader.entrypoint;
+            m_shaders_info2[shader.type] = &shader;
+        };
+    };
+}
+
+void VKProgramApi::PromotePushConstants(ShaderType type, std::vector<uint32_t>& spirv)
+{
+    m_push_constant_blocks.erase(type);
+    if (!ShaderType2Bit(type) || spirv.empty())
+        return;
+
+    // Stages share the push constant budget, every stage gets its own range after the ranges of the other stages
+    uint32_t base_offset = 0;
+    for (auto& x : m_push_constant_blocks)
+        base_offset = std::max(base_offset, x.second.offset + x.second.size);
+
+    spirv_cross::Compiler compiler(spirv);
+    spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+    if (!resources.push_constant_buffers.empty())
+        return;
+
+    // Only one push constant block is allowed per stage, the smallest cbuffer is the most likely per-draw payload
+    const spirv_cross::Resource* best_res = nullptr;
+    uint32_t best_size = 0;
+    for (auto& res : resources.uniform_buffers)
+    {
+        uint32_t size = static_cast<uint32_t>(compiler.get_declared_struct_size(compiler.get_type(res.base_type_id)));
+        size = (size + 3) & ~3u;
+        if (base_offset + size > kMaxPushConstantsSize)
+            continue;
+        if (!best_res || size < best_size)
+        {
+            best_res = &res;
+            best_size = size;
+        }
+    }
+    if (!best_res)
+        return;
 
-    VkShaderModuleCreateInfo vertexShaderCreationInfo = {};
-    vertexShaderCreationInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertexShaderCreationInfo.codeSize = sizeof(uint32_t) * spirv.size();
-    vertexShaderCreationInfo.pCode = spirv.data();
+    std::string name = best_res->name;
+    if (PromoteToPushConstant(spirv, best_res->id, base_offset))
+        m_push_constant_blocks[type] = { name, base_offset, best_size };
+}
 
-    VkShaderModule shaderModule;
-    auto result = vkCreateShaderModule(m_context.m_device, &vertexShaderCreationInfo, nullptr, &shaderModule);
-    m_shaders[shader.type] = shaderModule;
-    m_shaders_info[shader.type] = shader.entrypoint;
-    m_shaders_info2[shader.type] = &shader;
+const VKProgramApi::PushConstantBlock* VKProgramApi::FindPushConstantBlock(const BindKey& bind_key) const
+{
+    auto it = m_push_constant_blocks.find(bind_key.shader_type);
+    if (it == m_push_constant_blocks.end())
+        return nullptr;
+    std::string name = GetBindingName(bind_key);
+    if (name == "$Globals")
+        name = "_Global";
+    if (name != it->second.name)
+        return nullptr;
+    return &it->second;
 }
 
 static void print_resources(const spirv_cross::Compiler &compiler, const char *tag, const spirv_cross::SmallVector<spirv_cross::Resource> &resources)
@@ -573,19 +972,23 @@ void VKProgramApi::ParseShader(ShaderType shader_type, const std::vector<uint32_
                 }
             }
 
+            auto& array_type = compiler.get_type(res.type_id);
+            uint32_t array_size = array_type.array.empty() ? 1 : array_type.array.front();
+
             bindings.emplace_back();
             VkDescriptorSetLayoutBinding& binding = bindings.back();
             binding.binding = compiler.get_decoration(res.id, spv::DecorationBinding);
             binding.descriptorType = res_type;
-            binding.descriptorCount = 1;
+            binding.descriptorCount = array_size;
             binding.stageFlags = ShaderType2Bit(shader_type);
 
             info.binding = binding.binding;
             info.descriptor_type = res_type;
+            info.array_size = array_size;
         }
     };
 
-    generate_bindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    generate_bindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     generate_bindings(resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
     generate_bindings(resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER);
     generate_bindings(resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
@@ -611,6 +1014,26 @@ size_t VKProgramApi::GetSetNumByShaderType(ShaderType type)
 
 void VKProgramApi::ParseShaders()
 {
+    // Relinking after a recompile replaces the reflection and layouts of the previous shaders,
+    // command buffers of frames in flight may still use the old layouts
+    VkDevice device = m_context.m_device;
+    std::vector<VkDescriptorSetLayout> old_set_layouts = std::move(m_descriptor_set_layouts);
+    m_descriptor_set_layouts.assign(old_set_layouts.size(), VK_NULL_HANDLE);
+    VkPipelineLayout old_pipeline_layout = m_pipeline_layout;
+    m_pipeline_layout = VK_NULL_HANDLE;
+    if (old_pipeline_layout != VK_NULL_HANDLE)
+    {
+        m_context.QueryOnDelete([device, old_set_layouts, old_pipeline_layout]
+        {
+            vkDestroyPipelineLayout(device, old_pipeline_layout, nullptr);
+            for (VkDescriptorSetLayout layout : old_set_layouts)
+                vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        });
+    }
+    m_shader_ref.clear();
+    for (auto& count : m_descriptor_count_by_set)
+        count.clear();
+
     for (auto & spirv_it : m_spirv)
     {
         auto& spirv = spirv_it.second;
@@ -647,6 +1070,18 @@ void VKProgramApi::ParseShaders()
     pipeline_layout_info.setLayoutCount = m_descriptor_set_layouts.size();
     pipeline_layout_info.pSetLayouts = m_descriptor_set_layouts.data();
 
+    std::vector<VkPushConstantRange> push_constant_ranges;
+    for (auto& x : m_push_constant_blocks)
+    {
+        push_constant_ranges.emplace_back();
+        VkPushConstantRange& range = push_constant_ranges.back();
+        range.stageFlags = ShaderType2Bit(x.first);
+        range.offset = x.second.offset;
+        range.size = x.second.size;
+    }
+    pipeline_layout_info.pushConstantRangeCount = push_constant_ranges.size();
+    pipeline_layout_info.pPushConstantRanges = push_constant_ranges.data();
+
     if (vkCreatePipelineLayout(m_context.m_device, &pipeline_layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS) {
         throw std::runtime_error("failed to vkCreatePipelineLayout");
     }
@@ -654,8 +1089,9 @@ void VKProgramApi::ParseShaders()
 
 void VKProgramApi::OnPresent()
 {
-    m_cbv_offset.get().clear();
-    m_changed_om = true;
+    for (auto& heap_cache : m_heap_cache.get())
+        heap_cache.clear();
+    m_dirty_sets = ~0u;
 }
 
 ShaderBlob VKProgramApi::GetBlobByType(ShaderType type) const
@@ -708,11 +1144,6 @@ VKView* ConvertView(const View::Ptr& view)
 void VKProgramApi::OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const Resource::Ptr & ires)
 {
     m_changed_om = true;
-    if (m_context.m_is_open_render_pass)
-    {
-        vkCmdEndRenderPass(m_context.m_cmd_bufs[m_context.GetFrameIndex()]);
-        m_context.m_is_open_render_pass = false;
-    }
 
     if (!ires)
         return;
@@ -728,28 +1159,13 @@ void VKProgramApi::OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const R
     VkAttachmentDescription& colorAttachment = m_attachment_descriptions[slot];
     colorAttachment.format = res.image.format;
     colorAttachment.samples = (VkSampleCountFlagBits)res.image.msaa_count;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     msaa_count = res.image.msaa_count;
-
-    VkAttachmentReference& colorAttachmentRef = m_attachment_references[slot];
-    colorAttachmentRef.attachment = slot;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; 
 }
 
 void VKProgramApi::OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr & ires)
 {
     m_changed_om = true;
-    if (m_context.m_is_open_render_pass)
-    {
-        vkCmdEndRenderPass(m_context.m_cmd_bufs[m_context.GetFrameIndex()]);
-        m_context.m_is_open_render_pass = false;
-    }
 
     if (!ires)
         return;
@@ -766,18 +1182,8 @@ void VKProgramApi::OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr &
     auto& m_depth_attachment = m_attachment_descriptions.back();
     m_depth_attachment.format = res.image.format;
     m_depth_attachment.samples = (VkSampleCountFlagBits)res.image.msaa_count;
-    m_depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    m_depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    m_depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    m_depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
-    m_depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    m_depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     msaa_count = res.image.msaa_count;
-
-    VkAttachmentReference& depthAttachmentReference = m_attachment_references.back();
-    depthAttachmentReference.attachment = m_attachment_descriptions.size() - 1;
-    depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 }
 
 void VKProgramApi::ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color)
@@ -788,12 +1194,14 @@ void VKProgramApi::ClearRenderTarget(uint32_t slot, const std::array<float, 4>&
     clear_color.float32[2] = color[2];
     clear_color.float32[3] = color[3];
     m_clear_cache.GetColorLoadOp(slot) = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    m_changed_om = true;
 }
 
 void VKProgramApi::ClearDepthStencil(uint32_t ClearFlags, float Depth, uint8_t Stencil)
 {
     m_clear_cache.GetDepth() = { Depth, Stencil };
     m_clear_cache.GetDepthLoadOp() = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    m_changed_om = true;
 }
 
 void VKProgramApi::SetRasterizeState(const RasterizerDesc& desc)
@@ -834,7 +1242,7 @@ void VKProgramApi::CreateInputLayout(
         attribute.binding = location;
         attribute.location = location;
         binding.binding = location;
-        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        binding.inputRate = IsInstanceInput(location) ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
         binding.stride = type.vecsize * type.width / 8;
 
         if (type.basetype == spirv_cross::SPIRType::Float)
@@ -885,7 +1293,6 @@ void VKProgramApi::CreateRenderPass(const std::vector<uint32_t>& spirv_binary)
     }
 
     m_attachment_descriptions.resize(m_num_rtv + 1);
-    m_attachment_references.resize(m_num_rtv + 1);
     m_attachment_views.resize(m_num_rtv + 1);
     m_rtv_size.resize(m_num_rtv + 1);
 }
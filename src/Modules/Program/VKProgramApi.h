@@ -7,6 +7,7 @@
 
 #include <spirv_cross.hpp>
 #include <spirv_hlsl.hpp>
+#include <unordered_map>
 
 #include "Context/VKDescriptorPool.h"
 #include "Program/CommonProgramApi.h"
@@ -22,13 +23,19 @@ public:
     void CreateGrPipeLine();
     void CreateComputePipeLine();
     void CreatePipeLine();
+    void UpdateSpecializationInfo();
+    VKPipelineKey GetGrPipelineKey() const;
+    VKPipelineKey GetComputePipelineKey() const;
     void UseProgram();
     virtual void ApplyBindings() override;
     virtual View::Ptr CreateView(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& res) override;
-    virtual void CompileShader(const ShaderBase& shader) override;
+    virtual ShaderJob PrepareShader(const ShaderBase& shader) override;
     void ParseShader(ShaderType type, const std::vector<uint32_t>& spirv_binary, std::vector<VkDescriptorSetLayoutBinding>& bindings);
     size_t GetSetNumByShaderType(ShaderType type);
     void ParseShaders();
+    void UpdateCBufferRanges();
+    void BindDescriptorSets();
+    void UpdatePushConstants();
 
     void OnPresent();
 
@@ -42,7 +49,12 @@ public:
         return m_framebuffer;
     }
 
-    void RenderPassBegin();
+    bool HasPendingClear() const
+    {
+        return m_has_pending_clear;
+    }
+
+    void RenderPassBegin(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
     virtual ShaderBlob GetBlobByType(ShaderType type) const override;
     virtual std::set<ShaderType> GetShaderTypes() const override
@@ -59,6 +71,8 @@ public:
     virtual void OnAttachSampler(ShaderType type, const std::string& name, uint32_t slot, const Resource::Ptr& ires) override;
     virtual void OnAttachRTV(uint32_t slot, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
     virtual void OnAttachDSV(const ViewDesc& view_desc, const Resource::Ptr& ires) override;
+    virtual void OnReattach(const BindKey& bind_key, const ViewDesc& view_desc, const Resource::Ptr& ires) override;
+    virtual void OnSetBinding(const BindKey& bind_key, const BoundResource& bound_res) override;
 
 
     virtual void ClearRenderTarget(uint32_t slot, const std::array<float, 4>& color) override;
@@ -68,6 +82,58 @@ public:
     virtual void SetDepthStencilState(const DepthStencilDesc& desc) override;
 
 private:
+    // Guaranteed minimum of maxPushConstantsSize
+    static constexpr uint32_t kMaxPushConstantsSize = 128;
+
+    struct PushConstantBlock
+    {
+        std::string name;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // Descriptor as read by the update templates, every kind of descriptor has the same stride
+    union DescriptorData
+    {
+        VkDescriptorImageInfo image_info;
+        VkDescriptorBufferInfo buffer_info;
+        VkBufferView texel_buffer_view;
+    };
+
+    // Bindings of one descriptor set flattened at link time, in binding order.
+    // Each binding is one template entry, its descriptors are consecutive elements of data.
+    struct DescriptorSetTable
+    {
+        std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+        std::vector<DescriptorData> data;
+        // Unbound descriptors must not be written, so there is a template per mask of bound entries
+        std::map<uint64_t, VkDescriptorUpdateTemplateKHR> templates;
+        std::vector<BindKey> dynamic_cbvs;
+        std::vector<uint32_t> dynamic_offsets;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    struct DescriptorSlot
+    {
+        size_t set_num;
+        size_t index;
+        VkDescriptorType descriptor_type;
+    };
+
+    struct CachedDescriptorSet
+    {
+        std::vector<DescriptorData> data;
+        VkDescriptorSet set;
+    };
+
+    static bool IsBound(VkDescriptorType descriptor_type, const DescriptorData& data);
+    void CreateDescriptorSetTables();
+    void DestroyDescriptorSetTables();
+    VkDescriptorSet UpdateDescriptorSet(size_t set_num);
+    VkDescriptorUpdateTemplateKHR GetUpdateTemplate(size_t set_num, uint64_t bound_mask);
+
+    void PromotePushConstants(ShaderType type, std::vector<uint32_t>& spirv);
+    const PushConstantBlock* FindPushConstantBlock(const BindKey& bind_key) const;
 
     void CreateInputLayout(
         const std::vector<uint32_t>& spirv_binary,
@@ -84,11 +150,12 @@ private:
     
 
     VkPipeline graphicsPipeline = VK_NULL_HANDLE;
-    VkPipelineLayout m_pipeline_layout;
+    VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+    // Unique across programs, handles of retired shader modules and layouts don't make pipeline keys collide
+    uint64_t m_link_id = 0;
     std::vector<VkDescriptorSetLayout> m_descriptor_set_layouts;
     std::vector<std::map<VkDescriptorType, size_t>> m_descriptor_count_by_set;
 
-    std::vector<VkDescriptorSet> m_descriptor_sets;
     std::map<ShaderType, size_t> m_shader_type2set;
 
     struct ShaderRef
@@ -105,6 +172,7 @@ private:
             spirv_cross::Resource res;
             VkDescriptorType descriptor_type;
             uint32_t binding;
+            uint32_t array_size = 1;
         };
 
         std::map<std::string, ResourceRef> resources;
@@ -116,15 +184,24 @@ private:
     size_t m_num_rtv = 0;
     
     std::vector<VkAttachmentDescription> m_attachment_descriptions;
-    std::vector<VkAttachmentReference> m_attachment_references;
     VkRenderPass m_render_pass = VK_NULL_HANDLE;
+    bool m_has_pending_clear = false;
 
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
 
     std::vector<VkVertexInputBindingDescription> binding_desc;
     std::vector<VkVertexInputAttributeDescription> attribute_desc;
     std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfo;
-    VkFramebuffer m_framebuffer;
+
+    // Current values of the specialization constants of a stage, pipelines are cached per set of values
+    struct SpecializationInfo
+    {
+        std::vector<VkSpecializationMapEntry> entries;
+        std::vector<uint32_t> data;
+        VkSpecializationInfo info = {};
+    };
+    std::map<ShaderType, SpecializationInfo> m_specialization_info;
+    VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
     std::vector<VkImageView> m_attachment_views;
     std::vector<std::pair<VkExtent2D, size_t>> m_rtv_size;
 
@@ -169,5 +246,16 @@ private:
     BlendDesc m_blend_desc;
     RasterizerDesc m_rasterizer_desc;
     bool m_is_compute = false;
-    std::map<std::map<BindKey, View::Ptr>, std::vector<VkDescriptorSet>> m_heap_cache;
+    std::vector<DescriptorSetTable> m_set_tables;
+    std::map<BindKey, DescriptorSlot> m_descriptor_slots;
+    // Bit per set whose data changed since its descriptor set was looked up
+    uint32_t m_dirty_sets = ~0u;
+    VkCommandBuffer m_bound_cmd_buf = VK_NULL_HANDLE;
+    // Descriptor sets per set number keyed by the hash of their data. They live in the per-frame descriptor pool,
+    // so the cache is dropped when that pool is reset
+    PerFrameData<std::vector<std::unordered_map<uint64_t, CachedDescriptorSet>>> m_heap_cache;
+    // Constant data of the current frame, bound as dynamic offsets into the chunks of the constant ring
+    std::map<BindKey, ConstantRing::Range> m_cbv_ranges;
+    // Small cbuffers rewritten as push constant blocks, at most one per stage
+    std::map<ShaderType, PushConstantBlock> m_push_constant_blocks;
 };
@@ -2,6 +2,7 @@
 #include <Utilities/State.h>
 #include <Utilities/VKUtility.h>
 #include <memory>
+#include <mutex>
 
 VKViewCreater::VKViewCreater(VKContext& context, const IShaderBlobProvider& shader_provider)
     : m_context(context)
@@ -57,7 +58,7 @@ void VKViewCreater::ParseShader(ShaderType shader_type, const std::vector<uint32
         }
     };
 
-    generate_bindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    generate_bindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     generate_bindings(resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
     generate_bindings(resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER);
     generate_bindings(resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
@@ -67,6 +68,8 @@ void VKViewCreater::ParseShader(ShaderType shader_type, const std::vector<uint32
 VKView::Ptr VKViewCreater::GetEmptyDescriptor(ResourceType res_type)
 {
     static std::map<ResourceType, VKView::Ptr> empty_handles;
+    static std::mutex empty_handles_mutex;
+    std::lock_guard<std::mutex> lock(empty_handles_mutex);
     auto it = empty_handles.find(res_type);
     if (it == empty_handles.end())
         it = empty_handles.emplace(res_type, CreateView()).first;
@@ -162,7 +165,7 @@ void VKViewCreater::CreateSrv(ShaderType type, const std::string& name, uint32_t
         break;
     }
     }
-    ASSERT_SUCCEEDED(vkCreateImageView(m_context.m_device, &view_info, nullptr, &handle.srv));
+    handle.srv = m_context.GetViewCache().GetImageView(view_info);
 }
 
 void VKViewCreater::CreateRTV(uint32_t slot, const ViewDesc& view_desc, const VKResource& res, VKView& handle)
@@ -181,5 +184,5 @@ void VKViewCreater::CreateRTV(uint32_t slot, const ViewDesc& view_desc, const VK
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.layerCount = res.image.array_layers;
 
-    ASSERT_SUCCEEDED(vkCreateImageView(m_context.m_device, &view_info, nullptr, &handle.om));
+    handle.om = m_context.GetViewCache().GetImageView(view_info);
 }
\ No newline at end of file
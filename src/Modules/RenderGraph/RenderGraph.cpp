@@ -0,0 +1,161 @@
+#include "RenderGraph/RenderGraph.h"
+#include <algorithm>
+#include <set>
+
+void RenderGraph::PassBuilder::Create(Resource::Ptr& res, const TextureDesc& desc)
+{
+    m_creates.push_back({ &res, desc });
+}
+
+void RenderGraph::PassBuilder::Read(const Resource::Ptr& res)
+{
+    m_reads.push_back(&res);
+}
+
+void RenderGraph::PassBuilder::Write(const Resource::Ptr& res)
+{
+    m_writes.push_back(&res);
+}
+
+void RenderGraph::PassBuilder::SetSideEffect()
+{
+    m_side_effect = true;
+}
+
+RenderGraph::RenderGraph(Context& context)
+    : m_context(context)
+{
+}
+
+void RenderGraph::Reset()
+{
+    m_passes.clear();
+}
+
+void RenderGraph::AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, const std::function<void()>& execute)
+{
+    m_passes.emplace_back();
+    Pass& pass = m_passes.back();
+    pass.name = name;
+    pass.execute = execute;
+    setup(pass.builder);
+}
+
+void RenderGraph::Compile()
+{
+    m_stats = {};
+    m_stats.passes = m_passes.size();
+
+    // Walking backwards, a pass is kept when it has side effects or a kept pass depends on its results
+    std::set<const Resource::Ptr*> needed;
+    for (size_t i = m_passes.size(); i-- > 0;)
+    {
+        Pass& pass = m_passes[i];
+        bool is_needed = pass.builder.m_side_effect;
+        for (auto& create : pass.builder.m_creates)
+            is_needed = is_needed || needed.count(create.res);
+        for (auto& write : pass.builder.m_writes)
+            is_needed = is_needed || needed.count(write);
+
+        pass.culled = !is_needed;
+        if (pass.culled)
+        {
+            ++m_stats.culled_passes;
+            continue;
+        }
+
+        for (auto& create : pass.builder.m_creates)
+            needed.erase(create.res);
+        needed.insert(pass.builder.m_reads.begin(), pass.builder.m_reads.end());
+        needed.insert(pass.builder.m_writes.begin(), pass.builder.m_writes.end());
+    }
+
+    std::map<const Resource::Ptr*, size_t> last_use;
+    for (size_t i = 0; i < m_passes.size(); ++i)
+    {
+        Pass& pass = m_passes[i];
+        if (pass.culled)
+            continue;
+        for (auto& create : pass.builder.m_creates)
+            last_use[create.res] = i;
+        for (auto& read : pass.builder.m_reads)
+            last_use[read] = i;
+        for (auto& write : pass.builder.m_writes)
+            last_use[write] = i;
+    }
+
+    // Textures of the previous compilation are preferred over new ones, so views cached by programs stay valid
+    std::vector<PhysicalTexture> retired = std::move(m_textures);
+    m_textures.clear();
+    for (size_t i = 0; i < m_passes.size(); ++i)
+    {
+        Pass& pass = m_passes[i];
+        for (auto& create : pass.builder.m_creates)
+        {
+            if (pass.culled)
+            {
+                create.res->reset();
+                continue;
+            }
+            *create.res = AcquireTexture(retired, create.desc, i, last_use[create.res]);
+            ++m_stats.transient_textures;
+        }
+    }
+    m_stats.physical_textures = m_textures.size();
+}
+
+void RenderGraph::Execute()
+{
+    for (auto& pass : m_passes)
+    {
+        if (pass.culled)
+            continue;
+        m_context.BeginEvent(pass.name);
+        pass.execute();
+        m_context.EndEvent();
+    }
+}
+
+const RenderGraph::Stats& RenderGraph::GetStats() const
+{
+    return m_stats;
+}
+
+bool RenderGraph::IsCompatible(const TextureDesc& physical, const TextureDesc& requested)
+{
+    return (physical.bind_flag & requested.bind_flag) == requested.bind_flag &&
+        physical.format == requested.format &&
+        physical.msaa_count == requested.msaa_count &&
+        physical.width == requested.width &&
+        physical.height == requested.height &&
+        physical.depth == requested.depth &&
+        physical.mip_levels == requested.mip_levels;
+}
+
+Resource::Ptr RenderGraph::AcquireTexture(std::vector<PhysicalTexture>& retired, const TextureDesc& desc, size_t first_use, size_t last_use)
+{
+    for (auto& texture : m_textures)
+    {
+        if (texture.last_use < first_use && IsCompatible(texture.desc, desc))
+        {
+            texture.last_use = last_use;
+            return texture.res;
+        }
+    }
+
+    PhysicalTexture texture;
+    auto it = std::find_if(retired.begin(), retired.end(), [&](const PhysicalTexture& x) { return IsCompatible(x.desc, desc); });
+    if (it != retired.end())
+    {
+        texture = std::move(*it);
+        retired.erase(it);
+    }
+    else
+    {
+        texture.desc = desc;
+        texture.res = m_context.CreateTexture(desc.bind_flag, desc.format, desc.msaa_count, desc.width, desc.height, desc.depth, desc.mip_levels);
+    }
+    texture.last_use = last_use;
+    m_textures.push_back(texture);
+    return texture.res;
+}
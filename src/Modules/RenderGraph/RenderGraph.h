@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Context/Context.h>
+#include <Resource/Resource.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Orders the passes of a frame by the resources they declare.
+// Resources are identified by the Resource::Ptr variables the passes already share through their Input
+// and Output structs. Textures created through the graph are transient: they are allocated by Compile
+// and a texture whose last reader has run is handed to a later pass asking for a compatible one.
+// Passes none of whose results are consumed are culled, unless they have side effects.
+// Layout and state transitions stay with the backends, which already track them per resource.
+class RenderGraph
+{
+public:
+    struct TextureDesc
+    {
+        uint32_t bind_flag = 0;
+        gli::format format = gli::format::FORMAT_UNDEFINED;
+        uint32_t msaa_count = 1;
+        int width = 0;
+        int height = 0;
+        int depth = 1;
+        int mip_levels = 1;
+    };
+
+    class PassBuilder
+    {
+    public:
+        // The texture is assigned to res by Compile and must be fully written by the pass
+        void Create(Resource::Ptr& res, const TextureDesc& desc);
+        void Read(const Resource::Ptr& res);
+        // Writes keep what earlier passes wrote, so they depend on those passes like reads do
+        void Write(const Resource::Ptr& res);
+        // Writes something the graph does not see, e.g. the back buffer or persistent resources
+        void SetSideEffect();
+
+    private:
+        friend class RenderGraph;
+        struct CreatedTexture
+        {
+            Resource::Ptr* res;
+            TextureDesc desc;
+        };
+        std::vector<CreatedTexture> m_creates;
+        std::vector<const Resource::Ptr*> m_reads;
+        std::vector<const Resource::Ptr*> m_writes;
+        bool m_side_effect = false;
+    };
+
+    struct Stats
+    {
+        size_t passes = 0;
+        size_t culled_passes = 0;
+        size_t transient_textures = 0;
+        size_t physical_textures = 0;
+    };
+
+    RenderGraph(Context& context);
+
+    void Reset();
+    void AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, const std::function<void()>& execute);
+    void Compile();
+    void Execute();
+
+    const Stats& GetStats() const;
+
+private:
+    struct Pass
+    {
+        std::string name;
+        std::function<void()> execute;
+        PassBuilder builder;
+        bool culled = false;
+    };
+
+    struct PhysicalTexture
+    {
+        TextureDesc desc;
+        Resource::Ptr res;
+        size_t last_use = 0;
+    };
+
+    static bool IsCompatible(const TextureDesc& physical, const TextureDesc& requested);
+    Resource::Ptr AcquireTexture(std::vector<PhysicalTexture>& retired, const TextureDesc& desc, size_t first_use, size_t last_use);
+
+    Context& m_context;
+    std::vector<Pass> m_passes;
+    std::vector<PhysicalTexture> m_textures;
+    Stats m_stats;
+};
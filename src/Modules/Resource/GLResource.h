@@ -12,6 +12,7 @@ public:
     GLuint buffer = 0;
     GLuint buffer_size = 0;
     GLuint buffer_stride = 0;
+    uint8_t* buffer_mapped = nullptr;
 
     struct Image
     {
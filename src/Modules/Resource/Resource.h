@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <tuple>
 
 #include <View/View.h>
 #include "Context/BaseTypes.h"
@@ -22,7 +24,12 @@ struct ViewDesc
     size_t count = -1;
     bool operator<(const ViewDesc& oth) const
     {
-        return level < oth.level;
+        return std::tie(level, count) < std::tie(oth.level, oth.count);
+    }
+
+    bool operator==(const ViewDesc& oth) const
+    {
+        return std::tie(level, count) == std::tie(oth.level, oth.count);
     }
 };
 
@@ -35,6 +42,7 @@ public:
 
     View::Ptr& GetView(const BindKey& view_key, const ViewDesc& view_desc)
     {
+        std::lock_guard<std::mutex> lock(m_views_mutex);
         std::pair<BindKey, ViewDesc> key = { view_key, view_desc };
         auto it = views.find(key);
         if (it == views.end())
@@ -44,6 +52,8 @@ public:
 
 private:
     std::map<std::pair<BindKey, ViewDesc>, View::Ptr> views;
+    // Programs recording on different threads create their views of shared resources concurrently
+    std::mutex m_views_mutex;
 };
 
 struct BufferDesc
@@ -0,0 +1,31 @@
+#include "Resource/VKResource.h"
+#include "Context/VKContext.h"
+
+VKResource::VKResource(VKContext& context)
+    : m_context(context)
+{
+}
+
+VKResource::~VKResource()
+{
+    // Swapchain images are not owned by the resource and have no memory attached
+    if (image.memory.memory != VK_NULL_HANDLE)
+        m_context.QueryOnDelete(image);
+    if (buffer.memory.memory != VK_NULL_HANDLE)
+        m_context.QueryOnDelete(buffer);
+}
+
+VkImageLayout VKResource::Image::GetLayout(uint32_t level, uint32_t layer) const
+{
+    size_t index = level * array_layers + layer;
+    if (index >= layout.size())
+        return VK_IMAGE_LAYOUT_UNDEFINED;
+    return layout[index];
+}
+
+void VKResource::Image::SetLayout(uint32_t level, uint32_t layer, VkImageLayout new_layout)
+{
+    if (layout.empty())
+        layout.resize(level_count * array_layers, VK_IMAGE_LAYOUT_UNDEFINED);
+    layout[level * array_layers + layer] = new_layout;
+}
@@ -2,40 +2,46 @@
 
 #include <vulkan/vulkan.h>
 #include "Resource/Resource.h"
+#include <Context/VKMemoryAllocator.h>
 
 class VKDescriptorHeapRange;
+class VKContext;
 
 using VKBindKey = std::tuple<size_t /*program_id*/, ShaderType /*shader_type*/, VkDescriptorType /*res_type*/, uint32_t /*slot*/>;
 
-static bool operator<(const VkImageSubresourceRange& lhs, const VkImageSubresourceRange& rhs)
-{
-    return std::tie(lhs.aspectMask, lhs.baseArrayLayer, lhs.baseMipLevel, lhs.layerCount, lhs.levelCount) <
-        std::tie(rhs.aspectMask, rhs.baseArrayLayer, rhs.baseMipLevel, rhs.layerCount, rhs.levelCount);
-}
-
 class VKResource : public Resource
 {
 public:
     using Ptr = std::shared_ptr<VKResource>;
 
+    VKResource(VKContext& context);
+    ~VKResource();
+
     struct Image
     {
         VkImage res = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
-      
-        std::map<VkImageSubresourceRange, VkImageLayout> layout;
+        VKMemoryAllocation memory;
+
+        // Current layout of every subresource, indexed by level * array_layers + layer
+        std::vector<VkImageLayout> layout;
         VkFormat format = VK_FORMAT_UNDEFINED;
         VkExtent2D size = {};
         size_t level_count = 1;
         size_t msaa_count = 1;
         size_t array_layers = 1;
+
+        VkImageLayout GetLayout(uint32_t level, uint32_t layer) const;
+        void SetLayout(uint32_t level, uint32_t layer, VkImageLayout new_layout);
     } image;
 
     struct Buffer
     {
         VkBuffer res = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VKMemoryAllocation memory;
         uint32_t size = 0;
+        // Created with kCbv or kCpuWrite, the CPU writes it in place and the caller ring-buffers it.
+        // Other buffers may be mapped too on unified memory, but the GPU of frames in flight still reads them.
+        bool cpu_write = false;
     } buffer;
 
     struct Sampler
@@ -53,17 +59,10 @@ public:
 
     Type res_type = Type::kUnknown;
 
-    VKResource::Ptr GetUploadResource(size_t subresource)
-    {
-        if (subresource >= m_upload_res.size())
-            m_upload_res.resize(subresource + 1);
-        return m_upload_res[subresource];
-    }
-
     virtual void SetName(const std::string& name) override
     {
     }
 
 private:
-    std::vector<VKResource::Ptr> m_upload_res;
+    VKContext& m_context;
 };
@@ -2,7 +2,7 @@
 #include "Shader/SpirvCompiler.h"
 #include <spirv_glsl.hpp>
 
-std::string GetGLSLShader(const ShaderBase& shader, const SpirvOption& option)
+std::string GetGLSLShader(const ShaderDesc& shader, const SpirvOption& option)
 {
     std::vector<uint32_t> spirv_binary = SpirvCompile(shader, option);
     spirv_cross::CompilerGLSL glsl(std::move(spirv_binary));
@@ -6,4 +6,4 @@
 #include "Shader/ShaderBase.h"
 #include "Shader/SpirvCompiler.h"
 
-std::string GetGLSLShader(const ShaderBase& shader, const SpirvOption& option);
+std::string GetGLSLShader(const ShaderDesc& shader, const SpirvOption& option);
@@ -0,0 +1,189 @@
+#include "Shader/ShaderWatcher.h"
+#include <Utilities/FileUtility.h>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    std::string NormalizePath(const std::string& path)
+    {
+        return fs::absolute(path).lexically_normal().string();
+    }
+
+    // Includes are resolved against the directory of the root shader, like the compilers do,
+    // files included under #if are collected too, so a few extra files may be watched
+    void CollectIncludes(const std::string& base_dir, const std::string& path, std::set<std::string>& files)
+    {
+        if (!files.insert(NormalizePath(path)).second)
+            return;
+
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            size_t pos = line.find_first_not_of(" \t");
+            if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0)
+                continue;
+            size_t begin = line.find_first_of("\"<", pos + 8);
+            if (begin == std::string::npos)
+                continue;
+            size_t end = line.find_first_of("\">", begin + 1);
+            if (end == std::string::npos)
+                continue;
+            CollectIncludes(base_dir, base_dir + line.substr(begin + 1, end - begin - 1), files);
+        }
+    }
+}
+
+ShaderWatcher::ShaderWatcher()
+{
+#ifdef __linux__
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1)
+        std::cerr << "Failed to initialize inotify, shaders are not watched" << std::endl;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (m_fd != -1)
+        close(m_fd);
+#endif
+}
+
+void ShaderWatcher::Add(const ShaderBase& shader, const Callback& callback)
+{
+    Entry& entry = m_shaders[&shader];
+    entry.callback = callback;
+    UpdateDependencies(shader, entry);
+}
+
+void ShaderWatcher::Remove(const ShaderBase& shader)
+{
+    m_shaders.erase(&shader);
+}
+
+void ShaderWatcher::Poll()
+{
+    if (m_shaders.empty())
+        return;
+
+    std::set<std::string> changed = GetChangedFiles();
+    if (changed.empty())
+        return;
+
+    // Callbacks may add or remove shaders
+    std::vector<const ShaderBase*> affected;
+    for (auto& shader : m_shaders)
+    {
+        for (const auto& file : shader.second.files)
+        {
+            if (changed.count(file))
+            {
+                affected.push_back(shader.first);
+                break;
+            }
+        }
+    }
+
+    for (const ShaderBase* shader : affected)
+    {
+        auto it = m_shaders.find(shader);
+        if (it == m_shaders.end())
+            continue;
+        // The change may have added or removed includes
+        UpdateDependencies(*shader, it->second);
+        Callback callback = it->second.callback;
+        callback();
+    }
+}
+
+void ShaderWatcher::UpdateDependencies(const ShaderBase& shader, Entry& entry)
+{
+    std::string shader_path = GetAssetFullPath(shader.shader_path);
+    std::string shader_dir = shader_path.substr(0, shader_path.find_last_of("\\/") + 1);
+    entry.files.clear();
+    CollectIncludes(shader_dir, shader_path, entry.files);
+    for (const auto& file : entry.files)
+        Watch(file);
+}
+
+#ifdef __linux__
+
+void ShaderWatcher::Watch(const std::string& file)
+{
+    std::string dir = fs::path(file).parent_path().string();
+    if (m_fd == -1 || !m_watched_dirs.insert(dir).second)
+        return;
+    int wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd == -1)
+    {
+        std::cerr << "Failed to watch " << dir << std::endl;
+        return;
+    }
+    m_dirs[wd] = dir;
+}
+
+std::set<std::string> ShaderWatcher::GetChangedFiles()
+{
+    std::set<std::string> changed;
+    if (m_fd == -1)
+        return changed;
+
+    alignas(inotify_event) char buf[4096];
+    for (;;)
+    {
+        ssize_t size = read(m_fd, buf, sizeof(buf));
+        if (size <= 0)
+            break;
+        for (char* ptr = buf; ptr < buf + size;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            auto it = m_dirs.find(event->wd);
+            if (it != m_dirs.end() && event->len)
+                changed.insert(NormalizePath(it->second + "/" + event->name));
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+void ShaderWatcher::Watch(const std::string& file)
+{
+    if (m_files.count(file))
+        return;
+    std::error_code ec;
+    m_files[file] = fs::last_write_time(file, ec);
+}
+
+std::set<std::string> ShaderWatcher::GetChangedFiles()
+{
+    std::set<std::string> changed;
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_last_check < std::chrono::milliseconds(500))
+        return changed;
+    m_last_check = now;
+
+    for (auto& file : m_files)
+    {
+        std::error_code ec;
+        auto time = fs::last_write_time(file.first, ec);
+        if (ec || time == file.second)
+            continue;
+        file.second = time;
+        changed.insert(file.first);
+    }
+    return changed;
+}
+
+#endif
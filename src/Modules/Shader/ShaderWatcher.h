@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Shader/ShaderBase.h"
+#include <Utilities/Singleton.h>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+// Watches the files of registered shaders, including the files they include, for hot reload.
+// Directories are watched rather than files, editors often save by replacing the file.
+// Uses inotify on Linux, elsewhere modification times are compared every half a second.
+class ShaderWatcher : public Singleton<ShaderWatcher>
+{
+public:
+    using Callback = std::function<void()>;
+
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    // The callback runs from Poll once the shader file or one of its includes changes
+    void Add(const ShaderBase& shader, const Callback& callback);
+    void Remove(const ShaderBase& shader);
+    // Does not block, meant to be called at frame boundaries
+    void Poll();
+
+private:
+    struct Entry
+    {
+        std::set<std::string> files;
+        Callback callback;
+    };
+
+    void UpdateDependencies(const ShaderBase& shader, Entry& entry);
+    void Watch(const std::string& file);
+    std::set<std::string> GetChangedFiles();
+
+    std::map<const ShaderBase*, Entry> m_shaders;
+#ifdef __linux__
+    int m_fd = -1;
+    std::map<int, std::string> m_dirs;
+    std::set<std::string> m_watched_dirs;
+#else
+    std::map<std::string, std::filesystem::file_time_type> m_files;
+    std::chrono::steady_clock::time_point m_last_check;
+#endif
+};
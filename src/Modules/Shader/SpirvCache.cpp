@@ -0,0 +1,213 @@
+#include "Shader/SpirvCache.h"
+#include <Utilities/Hash.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr uint32_t kMagic = 0x43505353; // "SSPC"
+    constexpr uint32_t kSpirvMagic = 0x07230203;
+
+    std::vector<char> ReadFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const std::vector<char>& data)
+            : m_data(data)
+        {
+        }
+
+        bool Read(void* dst, size_t size)
+        {
+            if (m_data.size() - m_offset < size)
+                return false;
+            memcpy(dst, m_data.data() + m_offset, size);
+            m_offset += size;
+            return true;
+        }
+
+        bool IsEnd() const
+        {
+            return m_offset == m_data.size();
+        }
+
+    private:
+        const std::vector<char>& m_data;
+        size_t m_offset = 0;
+    };
+
+    template<typename T>
+    void Write(std::string& dst, const T& value)
+    {
+        dst.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    uint64_t GetProcessId()
+    {
+#ifdef _WIN32
+        return GetCurrentProcessId();
+#else
+        return getpid();
+#endif
+    }
+}
+
+SpirvCache::SpirvCache(const std::string& dir, uint64_t max_size)
+    : m_dir(dir)
+    , m_max_size(max_size)
+{
+}
+
+bool SpirvCache::Load(uint64_t key, std::vector<uint32_t>& spirv) const
+{
+    std::string path = GetPath(key);
+    std::vector<char> data = ReadFile(path);
+    Reader reader(data);
+
+    uint32_t magic = 0;
+    uint64_t stored_key = 0;
+    uint32_t include_count = 0;
+    if (!reader.Read(&magic, sizeof(magic)) || magic != kMagic ||
+        !reader.Read(&stored_key, sizeof(stored_key)) || stored_key != key ||
+        !reader.Read(&include_count, sizeof(include_count)))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < include_count; ++i)
+    {
+        uint32_t path_size = 0;
+        if (!reader.Read(&path_size, sizeof(path_size)))
+            return false;
+        std::string include_path(path_size, '\0');
+        uint64_t hash = 0;
+        if (!reader.Read(&include_path[0], path_size) || !reader.Read(&hash, sizeof(hash)))
+            return false;
+        if (HashFile(include_path) != hash)
+            return false;
+    }
+
+    uint32_t word_count = 0;
+    if (!reader.Read(&word_count, sizeof(word_count)) || word_count == 0)
+        return false;
+    std::vector<uint32_t> words(word_count);
+    if (!reader.Read(words.data(), word_count * sizeof(uint32_t)) || !reader.IsEnd() || words.front() != kSpirvMagic)
+        return false;
+
+    // The modification time orders files for eviction
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+    spirv = std::move(words);
+    return true;
+}
+
+void SpirvCache::Store(uint64_t key, const std::vector<Include>& includes, const std::vector<uint32_t>& spirv) const
+{
+    if (spirv.empty())
+        return;
+
+    std::string data;
+    Write(data, kMagic);
+    Write(data, key);
+    Write(data, static_cast<uint32_t>(includes.size()));
+    for (const auto& include : includes)
+    {
+        Write(data, static_cast<uint32_t>(include.path.size()));
+        data.append(include.path);
+        Write(data, include.hash);
+    }
+    Write(data, static_cast<uint32_t>(spirv.size()));
+    data.append(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+
+    std::error_code ec;
+    fs::create_directories(m_dir, ec);
+
+    // Other threads and processes may store the same key at the same time, each writes its own file
+    static std::atomic<uint64_t> counter{ 0 };
+    std::stringstream tmp_path;
+    tmp_path << GetPath(key) << "." << GetProcessId() << "." << std::hash<std::thread::id>{}(std::this_thread::get_id()) << "." << counter++ << ".tmp";
+    {
+        std::ofstream file(tmp_path.str(), std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), data.size()))
+        {
+            file.close();
+            fs::remove(tmp_path.str(), ec);
+            return;
+        }
+    }
+    fs::rename(tmp_path.str(), GetPath(key), ec);
+    if (ec)
+        fs::remove(tmp_path.str(), ec);
+
+    Evict();
+}
+
+uint64_t SpirvCache::HashFile(const std::string& path)
+{
+    std::vector<char> data = ReadFile(path);
+    return HashBytes(data.data(), data.size());
+}
+
+std::string SpirvCache::GetPath(uint64_t key) const
+{
+    std::stringstream path;
+    path << m_dir << "/" << std::hex << key << ".spv";
+    return path.str();
+}
+
+void SpirvCache::Evict() const
+{
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type time;
+    };
+    std::vector<Entry> entries;
+    uint64_t total_size = 0;
+
+    // Files may be removed by other processes while iterating, errors only skip the entry
+    std::error_code ec;
+    for (fs::directory_iterator it(m_dir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() != ".spv")
+            continue;
+        std::error_code entry_ec;
+        uint64_t size = it->file_size(entry_ec);
+        fs::file_time_type time = it->last_write_time(entry_ec);
+        if (entry_ec)
+            continue;
+        entries.push_back({ it->path(), size, time });
+        total_size += size;
+    }
+    if (total_size <= m_max_size)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const auto& entry : entries)
+    {
+        if (total_size <= m_max_size)
+            break;
+        if (fs::remove(entry.path, ec))
+            total_size -= entry.size;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compiled SPIR-V on disk, one file per hash of the inputs known before compilation.
+// Includes are only known after compiling, so every file also lists the includes seen
+// with hashes of their contents, and is used only while all of them are unchanged.
+// Files are written under temporary names and renamed into place, so concurrent
+// writers never expose a partial file. The least recently used files are evicted
+// once the directory grows over max_size bytes.
+class SpirvCache
+{
+public:
+    struct Include
+    {
+        std::string path;
+        uint64_t hash;
+    };
+
+    SpirvCache(const std::string& dir, uint64_t max_size);
+
+    bool Load(uint64_t key, std::vector<uint32_t>& spirv) const;
+    void Store(uint64_t key, const std::vector<Include>& includes, const std::vector<uint32_t>& spirv) const;
+
+    static uint64_t HashFile(const std::string& path);
+
+private:
+    std::string GetPath(uint64_t key) const;
+    void Evict() const;
+
+    std::string m_dir;
+    uint64_t m_max_size;
+};
@@ -1,7 +1,9 @@
 #include "Shader/SpirvCompiler.h"
+#include "Shader/SpirvCache.h"
 #include <iostream>
 #include <fstream>
 #include <Utilities/FileUtility.h>
+#include <Utilities/Hash.h>
 #include <cassert>
 
 #include <shaderc.hpp>
@@ -37,6 +39,8 @@ public:
         data->res.content = data->source.c_str();
         data->res.content_length = data->source.size();
         data->res.user_data = data;
+        // Hashed like the cache checks it on load, the text mode read above differs on CRLF sources
+        m_includes.push_back({ data->path, SpirvCache::HashFile(data->path) });
         return &data->res;
     }
 
@@ -45,8 +49,15 @@ public:
         delete static_cast<Data*>(res->user_data);
     }
 
+    // Every include resolved while compiling, nested ones included
+    const std::vector<SpirvCache::Include>& GetIncludes() const
+    {
+        return m_includes;
+    }
+
 private:
     std::string m_base_path;
+    std::vector<SpirvCache::Include> m_includes;
     struct Data
     {
         std::string path;
@@ -55,6 +66,50 @@ private:
     };
 };
 
+SpirvCache& GetSpirvCache()
+{
+    static SpirvCache cache(GetExecutableDir() + "/spirv_cache", 64 * 1024 * 1024);
+    return cache;
+}
+
+// Everything that affects the output except the includes, which the cache checks by itself
+uint64_t GetSpirvCacheKey(const ShaderDesc& shader, const SpirvOption& option, const std::string& shader_dir, const std::string& source)
+{
+    // Bump when the compiler or the options passed to it change
+    static const uint32_t version = 1;
+    uint64_t key = HashBytes(&version, sizeof(version));
+    auto add_string = [&](const std::string& str)
+    {
+        uint64_t size = str.size();
+        key = HashBytes(&size, sizeof(size), key);
+        key = HashBytes(str.data(), str.size(), key);
+    };
+    auto add_value = [&](auto value)
+    {
+        key = HashBytes(&value, sizeof(value), key);
+    };
+
+    add_string(source);
+    add_string(shader_dir);
+    add_string(shader.entrypoint);
+    add_string(shader.target);
+    add_value(static_cast<uint32_t>(shader.type));
+    add_value(static_cast<uint64_t>(shader.define.size()));
+    for (const auto& x : shader.define)
+    {
+        add_string(x.first);
+        add_string(x.second);
+    }
+    add_value(option.invert_y);
+    add_value(option.auto_map_bindings);
+    add_value(option.hlsl_iomap);
+    add_value(option.resource_set_binding);
+    add_value(option.use_dxc);
+    add_value(option.vulkan_semantics);
+    add_value(option.fhlsl_functionality1);
+    return key;
+}
+
 std::vector<uint32_t> ShadercCompile(const ShaderDesc& shader, const SpirvOption& option)
 {
     shaderc_shader_kind shader_type;
@@ -76,14 +131,23 @@ std::vector<uint32_t> ShadercCompile(const ShaderDesc& shader, const SpirvOption
         return {};
     }
 
+    std::string shader_path = GetAssetFullPath(shader.shader_path);
+    std::string shader_dir = shader_path.substr(0, shader_path.find_last_of("\\/") + 1);
+    std::string source = ReadShaderFile(shader_path);
+
+    uint64_t cache_key = GetSpirvCacheKey(shader, option, shader_dir, source);
+    std::vector<uint32_t> spirv;
+    if (GetSpirvCache().Load(cache_key, spirv))
+        return spirv;
+
     shaderc::CompileOptions options;
     for (const auto &x : shader.define)
     {
         options.AddMacroDefinition(x.first, x.second);
     }
-    std::string shader_path = GetAssetFullPath(shader.shader_path);
-    std::string shader_dir = shader_path.substr(0, shader_path.find_last_of("\\/") + 1);
-    options.SetIncluder(std::make_unique<SpirvIncludeHandler>(shader_dir));
+    auto includer = std::make_unique<SpirvIncludeHandler>(shader_dir);
+    SpirvIncludeHandler& include_handler = *includer;
+    options.SetIncluder(std::move(includer));
     options.SetGenerateDebugInfo();
     options.SetSourceLanguage(shaderc_source_language_hlsl);
     options.SetAutoMapLocations(option.auto_map_bindings);
@@ -106,7 +170,6 @@ std::vector<uint32_t> ShadercCompile(const ShaderDesc& shader, const SpirvOption
         options.SetTargetEnvironment(shaderc_target_env_opengl, 0);
 
     shaderc::Compiler compiler;
-    std::string source = ReadShaderFile(GetAssetFullPath(shader.shader_path));
     shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, shader_type, shader.shader_path.c_str(), shader.entrypoint.c_str(), options);
 
     if (module.GetCompilationStatus() != shaderc_compilation_status_success)
@@ -115,11 +178,17 @@ std::vector<uint32_t> ShadercCompile(const ShaderDesc& shader, const SpirvOption
         return {};
     }
 
-    return { module.cbegin(), module.cend() };
+    spirv.assign(module.cbegin(), module.cend());
+    GetSpirvCache().Store(cache_key, include_handler.GetIncludes(), spirv);
+    return spirv;
 }
 
-std::vector<uint32_t> SpirvCompile(const ShaderDesc& shader, const SpirvOption& option)
+std::vector<uint32_t> SpirvCompile(const ShaderDesc& desc, const SpirvOption& option)
 {
+    // Specialization constants only exist in SPIR-V, shaders declare them under this define
+    ShaderDesc shader = desc;
+    shader.define["SPIRV"] = "1";
+
 #ifdef _WIN32
     if (option.use_dxc)
     {
@@ -0,0 +1,120 @@
+#include "Shader/SpirvPatcher.h"
+#include <map>
+#include <set>
+#include <spirv.hpp>
+
+namespace
+{
+    constexpr size_t kHeaderSize = 5;
+    constexpr size_t kBoundIndex = 3;
+
+    struct Instruction
+    {
+        size_t pos;
+        spv::Op op;
+        uint32_t word_count;
+    };
+
+    std::vector<Instruction> ParseInstructions(const std::vector<uint32_t>& spirv)
+    {
+        std::vector<Instruction> instructions;
+        size_t pos = kHeaderSize;
+        while (pos < spirv.size())
+        {
+            uint32_t word_count = spirv[pos] >> 16;
+            if (word_count == 0 || pos + word_count > spirv.size())
+                return {};
+            instructions.push_back({ pos, static_cast<spv::Op>(spirv[pos] & 0xffff), word_count });
+            pos += word_count;
+        }
+        return instructions;
+    }
+
+    bool IsAccessChain(spv::Op op)
+    {
+        return op == spv::OpAccessChain || op == spv::OpInBoundsAccessChain || op == spv::OpPtrAccessChain || op == spv::OpCopyObject;
+    }
+}
+
+bool PromoteToPushConstant(std::vector<uint32_t>& spirv, uint32_t variable_id, uint32_t base_offset)
+{
+    if (spirv.size() <= kHeaderSize || spirv[0] != spv::MagicNumber)
+        return false;
+    std::vector<Instruction> instructions = ParseInstructions(spirv);
+    if (instructions.empty())
+        return false;
+
+    std::map<uint32_t, const Instruction*> pointer_types;
+    uint32_t block_pointer_type = 0;
+    for (auto& inst : instructions)
+    {
+        if (inst.op == spv::OpTypePointer)
+            pointer_types[spirv[inst.pos + 1]] = &inst;
+        else if (inst.op == spv::OpVariable && spirv[inst.pos + 2] == variable_id)
+            block_pointer_type = spirv[inst.pos + 1];
+    }
+    auto block_pointer_it = pointer_types.find(block_pointer_type);
+    if (block_pointer_it == pointer_types.end() || spirv[block_pointer_it->second->pos + 2] != spv::StorageClassUniform)
+        return false;
+    uint32_t block_type = spirv[block_pointer_it->second->pos + 3];
+
+    // Pointers derived from the block change their storage class too, so they need pointer types of their own
+    std::set<uint32_t> derived_ids = { variable_id };
+    std::map<uint32_t, uint32_t> push_constant_pointer_types;
+    uint32_t bound = spirv[kBoundIndex];
+    for (auto& inst : instructions)
+    {
+        if (!IsAccessChain(inst.op) || inst.word_count < 4 || !derived_ids.count(spirv[inst.pos + 3]))
+            continue;
+        derived_ids.insert(spirv[inst.pos + 2]);
+        uint32_t result_type = spirv[inst.pos + 1];
+        if (!push_constant_pointer_types.count(result_type))
+            push_constant_pointer_types[result_type] = bound++;
+    }
+
+    std::vector<uint32_t> patched(spirv.begin(), spirv.begin() + kHeaderSize);
+    patched[kBoundIndex] = bound;
+    for (auto& inst : instructions)
+    {
+        std::vector<uint32_t> words(spirv.begin() + inst.pos, spirv.begin() + inst.pos + inst.word_count);
+        switch (inst.op)
+        {
+        case spv::OpDecorate:
+            if (words[1] == variable_id && (words[2] == spv::DecorationBinding || words[2] == spv::DecorationDescriptorSet))
+                continue;
+            break;
+        case spv::OpMemberDecorate:
+            if (words[1] == block_type && words[3] == spv::DecorationOffset)
+                words[4] += base_offset;
+            break;
+        case spv::OpVariable:
+            if (words[2] == variable_id)
+                words[3] = spv::StorageClassPushConstant;
+            break;
+        default:
+            if (IsAccessChain(inst.op) && derived_ids.count(words[2]))
+                words[1] = push_constant_pointer_types[words[1]];
+            break;
+        }
+        patched.insert(patched.end(), words.begin(), words.end());
+
+        // The pointee types are declared before the block, so the new pointers can follow the pointer to the block
+        if (inst.op == spv::OpTypePointer && words[1] == block_pointer_type)
+        {
+            patched[patched.size() - 2] = spv::StorageClassPushConstant;
+            for (auto& x : push_constant_pointer_types)
+            {
+                auto it = pointer_types.find(x.first);
+                if (it == pointer_types.end())
+                    return false;
+                patched.push_back((4 << 16) | spv::OpTypePointer);
+                patched.push_back(x.second);
+                patched.push_back(spv::StorageClassPushConstant);
+                patched.push_back(spirv[it->second->pos + 3]);
+            }
+        }
+    }
+
+    spirv = std::move(patched);
+    return true;
+}
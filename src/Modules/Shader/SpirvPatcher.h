@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Turns the uniform block behind variable_id into a push constant block whose members start at base_offset.
+// The binding decorations of the block are dropped, so reflection no longer reports it as a uniform buffer.
+bool PromoteToPushConstant(std::vector<uint32_t>& spirv, uint32_t variable_id, uint32_t base_offset);
@@ -47,8 +47,8 @@ inline std::string GetExecutablePath()
     GetModuleFileNameA(nullptr, buf, sizeof(buf));
     return buf;
 #else
-    char buf[BUFSIZ];
-    readlink("/proc/self/exe", buf, sizeof(buf));
+    char buf[BUFSIZ] = {};
+    readlink("/proc/self/exe", buf, sizeof(buf) - 1);
     return buf;
 #endif
 }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+template <typename T>
+inline void HashCombine(size_t& seed, const T& value)
+{
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// FNV-1a, stable across runs and platforms unlike std::hash, for keys that are persisted
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        seed ^= bytes[i];
+        seed *= 1099511628211ull;
+    }
+    return seed;
+}
@@ -7,7 +7,11 @@
 struct CurState : public Singleton<CurState>
 {
     bool vsync = true;
+    uint32_t frames_in_flight = 3;
     bool force_dxil = false;
+    bool shader_hot_reload = false;
+    // Instancing stress test, IBL and ray traced AO still see the first copy only
+    bool instanced_spheres = false;
     uint32_t required_gpu_index = -1;
     std::string gpu_name;
 };
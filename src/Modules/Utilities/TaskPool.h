@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Workers executing independent tasks in submission order, results and exceptions are handed back through futures
+class TaskPool
+{
+public:
+    TaskPool(size_t worker_count = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t i = 0; i < worker_count; ++i)
+            m_threads.emplace_back(&TaskPool::WorkerLoop, this);
+    }
+
+    ~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    template<typename Fn>
+    std::future<std::invoke_result_t<Fn>> Submit(Fn&& fn)
+    {
+        using Result = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> res = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace_back([task] { (*task)(); });
+        }
+        m_cv.notify_one();
+        return res;
+    }
+
+private:
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&] { return m_exit || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                    return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_exit = false;
+};
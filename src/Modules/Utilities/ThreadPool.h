@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers executing index ranges, the calling thread takes part as worker 0
+class ThreadPool
+{
+public:
+    using Task = std::function<void(size_t worker, size_t index)>;
+
+    ThreadPool(size_t worker_count = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t i = 1; i < worker_count; ++i)
+            m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_start_cv.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    size_t GetWorkerCount() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    // Returns once task has run for every index in [0, count), rethrows the first exception of a task
+    void ParallelFor(size_t count, const Task& task)
+    {
+        if (count == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &task;
+            m_count = count;
+            m_next = 0;
+            m_active = m_threads.size();
+            m_exception = nullptr;
+            ++m_generation;
+        }
+        m_start_cv.notify_all();
+
+        RunTasks(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [&] { return m_active == 0; });
+        m_task = nullptr;
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+    }
+
+private:
+    void WorkerLoop(size_t worker)
+    {
+        size_t generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start_cv.wait(lock, [&] { return m_exit || m_generation != generation; });
+                if (m_exit)
+                    return;
+                generation = m_generation;
+            }
+
+            RunTasks(worker);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_active == 0)
+                m_done_cv.notify_all();
+        }
+    }
+
+    void RunTasks(size_t worker)
+    {
+        for (size_t index = m_next++; index < m_count; index = m_next++)
+        {
+            try
+            {
+                (*m_task)(worker, index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_exception)
+                    m_exception = std::current_exception();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start_cv;
+    std::condition_variable m_done_cv;
+    const Task* m_task = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next = { 0 };
+    size_t m_active = 0;
+    size_t m_generation = 0;
+    bool m_exit = false;
+    std::exception_ptr m_exception;
+};
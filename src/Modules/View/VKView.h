@@ -13,6 +13,6 @@ class VKView : public View
 {
 public:
     using Ptr = std::shared_ptr<VKView>;
-    VkImageView srv;
-    VkImageView om;
+    VkImageView srv = VK_NULL_HANDLE;
+    VkImageView om = VK_NULL_HANDLE;
 };